@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "thread_pool.h"
+
+//Symmetric matrix of 3x3 blocks in compressed sparse row format, one block row per node
+struct BlockSparseMatrix {
+	int rows = 0;
+	std::vector<int> rowStart; //Entries of row r are [rowStart[r], rowStart[r + 1])
+	std::vector<int> column;
+	std::vector<int> diagonal; //Entry of the diagonal block of every row
+	std::vector<glm::mat3> blocks;
+
+	//y = A * x, split by rows between the threads of the pool
+	void multiply(const glm::vec3 *x, glm::vec3 *y, ThreadPool &pool) const;
+};
+
+struct CGResult {
+	int iterations;
+	float residual; //||r|| / ||b|| at the end
+};
+
+//Preconditioned conjugate gradient with the inverse of the diagonal blocks as preconditioner.
+//"filter" is 1 for free rows and 0 for fixed ones, whose unknowns stay at 0. "x" holds the initial guess.
+//Reductions are done by fixed chunks, so the result doesn't depend on the number of threads
+CGResult solvePCG(const BlockSparseMatrix &A, const glm::vec3 *b, glm::vec3 *x, const float *filter, float tolerance, int maxIterations, ThreadPool &pool);
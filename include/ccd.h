@@ -0,0 +1,18 @@
+#pragma once
+#include <glm/glm.hpp>
+
+//Closest point of the triangle abc to p
+glm::vec3 closestPointTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c);
+
+//Closest points of the segments ab and cd, at a + s (b - a) and c + u (d - c)
+void closestPointsSegments(glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 d, float &s, float &u);
+
+//Continuous tests between a step start (0) and end (1) positions, every point moves on a straight line.
+//Both look for the times the four points are coplanar (a cubic) and return the first one with the features closer than "thickness".
+//A node going through a triangle, or two edges crossing, is found even if both ends of the step are far apart
+
+//Node p against the triangle abc
+bool vertexTriangleImpact(glm::vec3 p0, glm::vec3 p1, glm::vec3 a0, glm::vec3 a1, glm::vec3 b0, glm::vec3 b1, glm::vec3 c0, glm::vec3 c1, float thickness, float &t);
+
+//Edge ab against the edge cd, "s" and "u" are the points of the edges at the impact
+bool edgeEdgeImpact(glm::vec3 a0, glm::vec3 a1, glm::vec3 b0, glm::vec3 b1, glm::vec3 c0, glm::vec3 c1, glm::vec3 d0, glm::vec3 d1, float thickness, float &t, float &s, float &u);
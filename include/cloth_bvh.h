@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "cloth_grid.h"
+#include "particle_state.h"
+#include "thread_pool.h"
+
+//Shape and upkeep of the tree
+struct ClothBVHStats {
+	int nodes = 0;
+	int depth = 0; //Levels
+	int rebuilds = 0; //SAH rebuilds since the grid build
+	float cost = 0; //SAH cost: surface area of the internal nodes over the one of the root
+	float buildCost = 0; //Cost right after the last build
+};
+
+//Bounding volume hierarchy over the triangles of the cloth, two per quad of the grid like the ClothMesh faces.
+//It is built once splitting the grid in halves along its longer side, so every subtree is a patch of the cloth, and
+//refitted bottom-up every step, a level at a time in parallel. Only the boxes of the tree nodes are stored, the leaves
+//are refitted straight from the positions. When the refitted tree gets "rebuildRatio" times worse than after its last
+//build, it is rebuilt from the triangle centroids with binned SAH splits.
+//Self-collision, the collider pass and the ray picking all query this tree
+class ClothBVH {
+public:
+	//Leaves hold "count" triangles of the order from "first". Internal nodes have a count of 0 and the children "first" and "first" + 1
+	struct Node {
+		glm::vec3 low, high;
+		int first, count;
+	};
+
+	float rebuildRatio = 2;
+
+	void build(const ClothGrid &grid);
+
+	//Boxes of the current positions, and the last ones with "swept". Rebuilds the tree when it degraded
+	void refit(const ParticleState &state, bool swept, ThreadPool &pool);
+
+	const ClothGrid &grid() const { return treeGrid; }
+	const std::vector<glm::ivec3> &triangles() const { return triangleList; }
+	const ClothBVHStats &stats() const { return treeStats; }
+
+	//First triangle hit by the ray from "origin" along "direction", at origin + t * direction
+	bool raycast(const ParticleState &state, glm::vec3 origin, glm::vec3 direction, int &triangle, float &t) const;
+
+	//Calls visit(triangle) for the triangles of the leaves whose boxes, and the ones of all their ancestors, pass overlaps(low, high)
+	template <class Overlaps, class Visit>
+	void query(const Overlaps &overlaps, const Visit &visit) const {
+
+		if (nodes.empty()) { return; }
+		int stack[maxDepth + 1];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node &node = nodes[stack[--top]];
+			if (!overlaps(node.low, node.high)) { continue; }
+			if (node.count > 0) {
+				for (int k = node.first; k < node.first + node.count; k++) { visit(order[k]); }
+				continue;
+			}
+			stack[top++] = node.first + 1;
+			stack[top++] = node.first;
+		}
+	}
+
+private:
+	static const int maxDepth = 64;
+
+	void buildSAH(const ParticleState &state, bool swept); //From the centroids of the triangle boxes
+	void finishBuild(); //Levels and nodes of the leaves
+	void triangleBounds(const ParticleState &state, bool swept, int t, glm::vec3 &low, glm::vec3 &high) const;
+
+	ClothGrid treeGrid = { 0, 0 };
+	std::vector<glm::ivec3> triangleList;
+	std::vector<int> order; //Triangles of the leaves
+	std::vector<Node> nodes; //Level by level from the root
+	std::vector<int> levelStart; //Nodes of level l are [levelStart[l], levelStart[l + 1])
+	std::vector<int> leafNodeStart, leafNodes; //Cloth nodes of every leaf, the ones of tree node i are [leafNodeStart[i], leafNodeStart[i + 1])
+	std::vector<float> nodeArea; //Surface of the internal nodes after the last refit, 0 on the leaves
+	bool costPending = false; //The build cost is measured on the first refit after a build
+	ClothBVHStats treeStats;
+};
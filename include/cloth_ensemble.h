@@ -0,0 +1,48 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "cloth_simulation.h"
+
+//Material of one instance of an ensemble, the parameters a calibration sweeps
+struct EnsembleMaterial {
+	float Ke; //Stiffness
+	float Kd; //Damping
+	float elasticity; //Of every collider
+	int maxElongation; //%
+};
+
+//Summary of one instance, on its current state
+struct EnsembleMetrics {
+	float sag; //Drop of the lowest node below the initial height
+	float maxStrain; //Max elongation of the structural and shear springs, as a fraction of the rest length
+	float energy; //Kinetic, spring and gravitational (above y = 0)
+};
+
+//Instances of one group, stored together. Node i of lane l is at i * lanes + l of "nodes", so a SIMD instruction
+//advances the same node of several instances (AoSoA). Lanes past the last instance repeat it and are never read
+struct EnsembleGroup {
+	ParticleState nodes;
+	float *Ke = nullptr, *Kd = nullptr, *elasticity = nullptr, *maxScale = nullptr; //Per lane, aligned for the SIMD loads
+	SoAArena parameters; //The four per lane arrays
+	int instances = 0;
+};
+
+//Many instances of the same cloth with different materials, stepped "lanes" (8 or 16) at a time. Every instance
+//gives the same result as a ClothSimulation with its material, symplectic Euler and Gauss-Seidel strain limiting.
+//The groups are split between the threads of the pool of "mesh"
+struct ClothEnsemble {
+	ClothSimulation mesh; //Shared mesh, springs, rest state, colliders and parameters. Its own state isn't stepped
+	std::vector<EnsembleMaterial> materials;
+	std::vector<std::unique_ptr<EnsembleGroup>> groups;
+	int lanes = 8;
+
+	//Groups for the materials, at the rest state of "mesh". The parameters of "mesh" are set before
+	void allocate(ClothGrid grid, const std::vector<EnsembleMaterial> &instances);
+	void release();
+	void reset();
+	void step(float dt);
+
+	glm::vec3 position(int instance, int node) const;
+	EnsembleMetrics metrics(int instance) const;
+};
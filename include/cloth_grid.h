@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+
+//Smallest and biggest number of nodes per side of the cloth
+const int minClothSide = 2;
+const int maxClothSide = 1024;
+
+//Mesh descriptor shared by the physics and the rendering of the cloth
+struct ClothGrid {
+	int rows;
+	int columns;
+
+	int totalVertex() const { return rows * columns; }
+	int index(int row, int column) const { return row * columns + column; }
+
+	bool operator==(const ClothGrid &other) const { return rows == other.rows && columns == other.columns; }
+	bool operator!=(const ClothGrid &other) const { return !(*this == other); }
+};
+
+//Grid of the simulated cloth, defined in physics.cpp and chosen at runtime
+extern ClothGrid clothGrid;
+
+//Comma separated "rowsxcolumns" of the command line drivers, false on a bad one or a side out of range
+bool parseGridList(const char *list, std::vector<ClothGrid> &grids);
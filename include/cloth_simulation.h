@@ -0,0 +1,127 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <thread>
+#include <glm/glm.hpp>
+
+#include "cloth_bvh.h"
+#include "cloth_grid.h"
+#include "grid_kernels.h"
+#include "particle_state.h"
+#include "precise_state.h"
+#include "springs.h"
+#include "strain_limit.h"
+#include "simd_kernels.h"
+#include "thread_pool.h"
+#include "integrators.h"
+#include "colliders.h"
+#include "self_collision.h"
+
+//Parameters of a cloth
+struct ClothParams {
+	int Ke = 100; //Stiffness
+	float Kd = 0.5f; //Damping
+	float L = 0.3f; //Rest distance
+	int maxElongation = 50; //%
+	float height = 9.9f;
+
+	//Strain limiting
+	float strainTolerance = 0.05f; //Stretch left over the max elongation, as a fraction of the rest length. Sweeps run until it is met
+	int strainIterations = 80; //Max sweeps, the default 18x14 cloth hangs as stiff as with a pass per node
+	StrainOrdering strainOrdering = StrainOrdering::GaussSeidel;
+
+	IntegratorType integrator = IntegratorType::SymplecticEuler;
+
+	//Self-collision, nodes are kept at "selfThickness" from the triangles
+	bool selfCollision = false;
+	float selfThickness = 0.1f;
+	SelfCollisionBroadphase selfBroadphase = SelfCollisionBroadphase::BVH;
+
+	//Swept tests over the motion of the step against the colliders and the cloth itself, for large timesteps
+	bool continuousCollisions = true;
+
+	//Linear solve of the implicit integrator
+	float solverTolerance = 1e-4f;
+	int solverIterations = 100;
+	bool solverWarmStart = true;
+
+	//Constraint solvers
+	int solverSubsteps = 10;
+	int constraintIterations = 1;
+
+	int threads = (int)std::thread::hardware_concurrency();
+	bool useSimd = true; //The scalar path is kept to compare results
+	bool gridKernels = true; //Spring forces as a stencil over the grid instead of the spring list
+	Precision precision = Precision::Float; //See activePrecision()
+};
+
+//Time spent on each stage of the last step (ms)
+struct StepTimings {
+	float forces = 0, integration = 0, strain = 0, selfCollision = 0, collisions = 0;
+};
+
+//A cloth and its colliders, without any window or GL dependency. The render and the headless driver own one
+struct ClothSimulation {
+	ClothGrid grid = { 0, 0 };
+	ClothParams params;
+	ParticleState nodes;
+
+	//Springs of the mesh sorted by color
+	std::vector<Spring> springs;
+	std::vector<int> springColors;
+	float springsL = 0; //Rest distance of the rest lengths
+
+	//Collision shapes, applied in order after every step. Animated ones are moved at the start of the step
+	std::vector<Collider> colliders = defaultColliders();
+	std::vector<ColliderAnimation> animations;
+	float time = 0; //Since the last reset
+
+	std::unique_ptr<Integrator> integrator;
+	ClothBVH bvh; //Triangles of the cloth, refitted by the self-collision and shared with the collider pass and the picking
+	float bvhMargin = -1; //Max distance the nodes moved since the last refit, negative when the tree is stale
+	SelfCollision selfCollision;
+	StrainScratch strainScratch; //Jacobi strain limiting
+	std::vector<unsigned char> collisionBlocks; //Blocks of simdWidth nodes near a collider
+	std::vector<int> activeBlocks;
+	ThreadPool pool;
+	StepTimings timings;
+	int strainSweeps = 0; //Of the last step
+
+	PreciseState precise; //Double state of the Mixed and Double precisions
+	StrainScratchDouble preciseStrainScratch;
+	Precision statePrecision = Precision::Float; //Of the last step, the double state is loaded again after a Float one
+
+	void allocate(ClothGrid size); //Creation of the node arrays of a grid, and reset
+	void release();
+	void reset(); //Flat mesh with an "L" separation, at rest
+	void step(float dt);
+
+	//Parameters can change between steps without a reset. Ke, Kd and the max elongation are read by every step, and
+	//the rest lengths of the springs follow "L" at the start of the next one
+	void applyParameters();
+
+	glm::vec3 initialPosition(int row, int column) const;
+	bool isPinned(int i) const;
+	KernelPath kernelPath() const;
+	//Precision the next step runs with. Mixed needs an integrator that moves the nodes by x += dt * v with its new velocities
+	//(symplectic and implicit Euler), Double the symplectic Euler one. Others fall back to the closest one they support
+	Precision activePrecision() const;
+
+	//Node of the first triangle hit by the ray closest to the hit, or -1
+	int pickNode(glm::vec3 origin, glm::vec3 direction);
+
+	//Clears "force" and accumulates the spring forces of a state
+	void calculateAllForces(const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force);
+	void calculatePreciseForces(); //On the double state, with the grid kernels or the spring list as gridKernels says
+	template <class Real>
+	void gridForces(BasicGridForceKernel<Real> kernel, const BasicSoAVec3<Real> &pos, const BasicSoAVec3<Real> &vel, BasicSoAVec3<Real> &force);
+
+	//Stages of a step after the integration
+	void checkElongation();
+	void refitBVH();
+	void calculateSelfCollisions();
+	void calculateAllCollisions(float dt); //Batched pass over the nodes near the colliders, "dt" is the step the colliders moved on
+
+	//Max difference between the SIMD and the scalar forces of the current state
+	float compareKernels();
+};
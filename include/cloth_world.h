@@ -0,0 +1,28 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "cloth_simulation.h"
+#include "work_stealing_pool.h"
+
+//One cloth of a world, with its own state, parameters and colliders
+struct ClothInstance {
+	ClothSimulation simulation;
+	float stepTime = 0; //ms of its last step, the cost used to deal the instances to the threads
+};
+
+//Many cloths stepped together. Each instance is stepped by one thread of the world, and the threads steal
+//instances from each other so cloths of different sizes balance across the cores
+struct ClothWorld {
+	std::vector<std::unique_ptr<ClothInstance>> instances;
+	WorkStealingPool pool;
+	int threads = (int)std::thread::hardware_concurrency();
+
+	//New instance with its node arrays allocated. Its own pool is set to one thread, the world threads run the instances
+	ClothInstance &add(ClothGrid grid, const ClothParams &params);
+	void remove(int index);
+	void clear();
+
+	void step(float dt);
+	int totalNodes() const;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+//Planes and boxes keep the nodes inside, spheres and capsules keep them outside
+enum class ColliderType { Plane = 0, Box = 1, Sphere = 2, Capsule = 3 };
+
+//Collision shape with its own response. Nodes inside a shape are mirrored out with the elasticity,
+//and the friction takes away tangential velocity in proportion to the normal impulse (Coulomb)
+struct Collider {
+	ColliderType type;
+	glm::vec3 normal; //Plane, the inside is dot(normal, x) + offset >= 0
+	float offset;
+	glm::vec3 min, max; //Box corners
+	glm::vec3 center, end; //Sphere center, capsule segment from center to end
+	float radius;
+	float elasticity;
+	float friction;
+	glm::vec3 velocity; //Kinematic shapes, the response works on the velocity relative to the shape
+	bool enabled;
+};
+
+Collider planeCollider(glm::vec3 normal, float offset, float elasticity, float friction);
+Collider boxCollider(glm::vec3 min, glm::vec3 max, float elasticity, float friction);
+Collider sphereCollider(glm::vec3 center, float radius, float elasticity, float friction);
+Collider capsuleCollider(glm::vec3 a, glm::vec3 b, float radius, float elasticity, float friction);
+
+//False when no point of the box [low, high] is inside the collider, the nodes in it can skip it. A box inside a rejected
+//one is rejected too, so it also prunes the BVH of the cloth. "shift" is what the collider moved on the step, the box is grown by it for the swept tests
+bool colliderMayTouch(const Collider &collider, glm::vec3 low, glm::vec3 high, glm::vec3 shift);
+
+const char *colliderTypeName(ColliderType type);
+
+//Kinematic motion of a collider: its shape oscillates around the rest position by amplitude * sin(2 pi frequency t)
+struct ColliderAnimation {
+	int collider; //Index on the collider list
+	glm::vec3 center, end; //Rest position
+	glm::vec3 amplitude;
+	float frequency;
+};
+
+//Moves the collider to its position at time t, with the velocity of the motion
+void animateCollider(Collider &collider, const ColliderAnimation &animation, float t);
+
+//The cube around the cloth
+std::vector<Collider> defaultColliders();
@@ -0,0 +1,24 @@
+#pragma once
+#include "cloth_grid.h"
+#include "particle_state.h"
+#include "simd_kernels.h"
+
+//Springs of a full grid mesh as buildSprings makes them: the rest length of each kind and the material
+struct GridSpringParams {
+	float structural, shear, bending;
+	float Ke, Kd;
+};
+
+//Adds the spring forces of the nodes of the rows [firstRow, lastRow) as a stencil over the grid. The springs of a node go to
+//the offsets +1, +2, +columns - 1, +columns, +columns + 1 and +2 * columns, so the nodes of a row and their neighbors are
+//contiguous loads instead of gathers. Writes reach two rows past "lastRow": bands of rows that far apart can run at once
+template <class Real>
+using BasicGridForceKernel = void (*)(const BasicSoAVec3<Real> &pos, const BasicSoAVec3<Real> &vel, BasicSoAVec3<Real> &force, ClothGrid grid, int firstRow, int lastRow, const GridSpringParams &params);
+
+typedef BasicGridForceKernel<float> GridForceKernel;
+typedef BasicGridForceKernel<double> GridForceKernelDouble; //Double precision state, half the lanes of the float one
+
+//Kernel of a path for a grid. Common resolutions have one compiled for their size, with the offsets and trip counts as
+//constants, any other size gets the runtime-sized one. "specialized" tells which
+GridForceKernel gridForceKernel(KernelPath path, ClothGrid grid, bool *specialized = nullptr);
+GridForceKernelDouble gridForceKernelDouble(KernelPath path, ClothGrid grid, bool *specialized = nullptr);
@@ -0,0 +1,75 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "cloth_grid.h"
+#include "particle_state.h"
+#include "simd_kernels.h"
+#include "springs.h"
+#include "thread_pool.h"
+
+enum class IntegratorType { ExplicitEuler = 0, SymplecticEuler = 1, Verlet = 2, RK4 = 3, ImplicitEuler = 4, XPBD = 5, ProjectiveDynamics = 6 };
+const int integratorCount = 7;
+
+const char *integratorName(IntegratorType type);
+
+//Short lowercase names for the command line drivers
+const char *integratorOption(IntegratorType type);
+bool parseIntegratorOption(const char *option, IntegratorType &type);
+
+//Clears "force" and evaluates on it the forces (without gravity) of a position and velocity state
+typedef std::function<void(const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force)> ForceFunction;
+
+//Cloth seen by the integrators
+struct IntegrationContext {
+	ForceFunction forces;
+	const std::vector<Spring> *springs;
+	const std::vector<int> *springColors; //Color offsets of the spring list
+	float Ke, Kd;
+	ThreadPool *pool;
+	ClothGrid grid;
+
+	//Linear solve of the implicit integrator
+	float tolerance;
+	int maxIterations;
+	bool warmStart; //Start from the solution of the previous step
+
+	//Constraint solvers
+	int substeps;
+	int iterations;
+};
+
+//Last linear solve of an implicit integrator
+struct SolverStats {
+	int iterations = 0;
+	float residual = 0;
+
+	//Prefactored solvers
+	int factorizations = 0;
+	size_t factorNonZeros = 0;
+	int fallbackSteps = 0; //Taken with symplectic Euler because the factorization failed, it is tried again on the next step
+};
+
+//Time integration scheme. All of them work on the SoA state
+class Integrator {
+public:
+	virtual ~Integrator() {}
+	virtual IntegratorType type() const = 0;
+
+	//Advances the state by dt, storing the previous positions on state.last.
+	//state.force already holds the forces of the current state, context.forces is used for the extra evaluations
+	virtual void step(KernelPath path, ParticleState &state, const IntegrationContext &context, float dt, glm::vec3 gravity) = 0;
+
+	virtual SolverStats stats() const { return SolverStats(); }
+
+	//False when the integrator doesn't need state.force before the step
+	virtual bool usesForces() const { return true; }
+};
+
+std::unique_ptr<Integrator> createIntegrator(IntegratorType type);
+
+//Constraint based solvers, on their own files
+std::unique_ptr<Integrator> createXPBDSolver();
+std::unique_ptr<Integrator> createPDSolver();
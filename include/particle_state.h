@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <glm/glm.hpp>
+
+//Nodes processed by one SIMD instruction, per-node arrays are padded to a multiple of it
+const int simdWidth = 8;
+const int simdAlignment = 32;
+
+//Three aligned arrays, one per coordinate. The solver state is float, the Mixed and Double precisions keep a double copy
+template <class Real>
+struct BasicSoAVec3 {
+	Real *x, *y, *z;
+
+	glm::tvec3<Real> get(int i) const { return { x[i], y[i], z[i] }; }
+	void set(int i, const glm::tvec3<Real> &v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+};
+
+typedef BasicSoAVec3<float> SoAVec3;
+typedef BasicSoAVec3<double> SoAVec3Double;
+
+//Helpers over SoA arrays of "capacity" nodes
+template <class Real> void clearSoA(BasicSoAVec3<Real> &v, int capacity);
+template <class Real> void copySoA(BasicSoAVec3<Real> &destination, const BasicSoAVec3<Real> &source, int capacity);
+
+//One aligned block split in arrays of "capacity" nodes, instead of an allocation per array.
+//The block is only replaced when a resize doesn't fit in it, and freed by release() or the destructor
+template <class Real>
+class BasicSoAArena {
+public:
+	BasicSoAArena() = default;
+	~BasicSoAArena() { release(); }
+	BasicSoAArena(const BasicSoAArena&) = delete;
+	BasicSoAArena &operator=(const BasicSoAArena&) = delete;
+
+	//Elements from one array to the next. The padding keeps arrays of a multiple of the page size from starting
+	//at the same page offset, where their loads would alias on the cache
+	static int stride(int capacity) { return capacity + 2 * simdWidth; }
+
+	Real *reserve(int arrays, int capacity); //Zeroed arrays, at block + k * stride(capacity)
+	BasicSoAVec3<Real> soa(int first, int capacity) const; //Arrays "first" to "first + 2" as a BasicSoAVec3
+	void release();
+	size_t bytes() const { return reserved * sizeof(Real); }
+
+private:
+	Real *block = nullptr;
+	size_t reserved = 0; //Elements
+};
+
+typedef BasicSoAArena<float> SoAArena;
+typedef BasicSoAArena<double> SoAArenaDouble;
+
+//Structure of arrays state of all the nodes of a cloth, on one arena
+struct ParticleState {
+	int count = 0;    //Number of nodes
+	int capacity = 0; //Allocated nodes, multiple of simdWidth. Padding nodes are fixed (invMass 0) and at rest
+	SoAVec3 pos = {};
+	SoAVec3 vel = {};
+	SoAVec3 force = {};
+	SoAVec3 last = {}; //Position on the previous step
+	float *invMass = nullptr; //0 for the fixed nodes
+	SoAArena arena; //pos, vel, force and last (3 arrays each), and invMass
+
+	void allocate(int nodes); //Keeps the arena when the new size fits in it
+	void release();
+	void clearForces();
+	void packPositions(float *xyz) const; //Interleaved xyz, as the rendering expects
+};
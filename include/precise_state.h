@@ -0,0 +1,39 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "particle_state.h"
+
+//Precision of the node state and of the math of a step.
+//Float: everything in float. Mixed: positions in double, forces, velocities and the SIMD kernels in float.
+//Double: positions, velocities, forces and strain limiting in double
+enum class Precision { Float = 0, Mixed = 1, Double = 2 };
+const int precisionCount = 3;
+
+const char *precisionName(Precision precision);
+
+//Short lowercase names for the command line drivers
+const char *precisionOption(Precision precision);
+bool parsePrecisionOption(const char *option, Precision &precision);
+
+//Double copy of the nodes for the Mixed and Double precisions. The ParticleState keeps the state rounded to float, it is
+//what the colliders, the self-collisions, the render and the picking read. Whatever they change on it is added back to
+//the double state by sync(), so a node only loses the bits of a float where a float stage moved it
+struct PreciseState {
+	int capacity = 0;
+	SoAVec3Double pos = {};
+	SoAVec3Double vel = {};
+	SoAVec3Double force = {};
+	SoAArenaDouble arena; //pos, vel and force (3 arrays each)
+
+	void load(const ParticleState &state); //Exact copy of the float state, allocates for its capacity
+	void release();
+
+	//Adds the changes of the float state since it was rounded, the velocities only when they are kept in double
+	void sync(ParticleState &state, bool velocities);
+	void round(ParticleState &state, bool velocities) const;
+
+	//Mixed: x += dt * v with the float velocities the integrator left on the state, "last" is already set
+	void advancePositions(ParticleState &state, float dt);
+	//Double: v += dt * w * (f + g), x += dt * v on the double state, then rounds it and sets "last"
+	void integrateSymplecticEuler(ParticleState &state, float dt, glm::vec3 gravity);
+};
@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Scoped timers around the stages of a frame. Builds with CLOTH_PROFILING defined (the Debug configurations) record them,
+//without it PROFILE_SCOPE expands to nothing and the timed code is the same as without the profiler.
+//Scopes of any thread add to the same timers, like the stages of the cloths of a world.
+//While the Tracer records, they are also events of the trace, like TRACE_SCOPE that can be used on any thread
+#ifdef CLOTH_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) \
+	static const int PROFILE_CONCAT(profileTimer, __LINE__) = Profiler::instance().timer(name); \
+	ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileTimer, __LINE__))
+#define TRACE_SCOPE(name) TraceScope PROFILE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_CURRENT_SCOPE() Tracer::currentScope()
+#define TRACE_THREAD_NAME(name) Tracer::nameThread(name)
+#else
+#define PROFILE_SCOPE(name)
+#define TRACE_SCOPE(name)
+#define TRACE_CURRENT_SCOPE() nullptr
+#define TRACE_THREAD_NAME(name)
+#endif
+
+const int profileWindow = 240; //Samples of the rolling statistics, 4 s of frames at 60 Hz
+const int maxProfileTimers = 64;
+
+//Over the last samples of a timer (ms)
+struct ProfileStats {
+	float last = 0, min = 0, avg = 0, p99 = 0;
+	int samples = 0;
+};
+
+//Named timers with a rolling window of samples each. Every scope adds one sample, and every frame can add a row
+//with the time and calls of each timer to a CSV file
+class Profiler {
+public:
+	static Profiler &instance();
+
+	int timer(const char *name); //Index of a timer, created on its first use
+	void add(int timer, float ms);
+	void endFrame(); //Writes the row of the frame when the CSV is open
+
+	bool startCsv(const char *path);
+	void stopCsv();
+	bool csvOpen() const { return csv != nullptr; }
+
+	int timerCount() const { return timers; }
+	const char *name(int timer) const { return list[timer].name.c_str(); }
+	ProfileStats stats(int timer) const;
+
+	//Samples of the window in a ring, the oldest at "offset"
+	const float *history(int timer, int &count, int &offset) const;
+
+private:
+	Profiler() = default;
+	~Profiler();
+
+	struct Timer {
+		std::string name;
+		float samples[profileWindow];
+		int next = 0, count = 0;
+		float frameMs = 0; //Since the last row
+		int frameCalls = 0;
+	};
+
+	Timer list[maxProfileTimers];
+	std::atomic<int> timers{ 0 };
+	mutable std::mutex mutex; //Timers and their samples, scopes of several threads can end at once
+	FILE *csv = nullptr;
+	int csvColumns = 0; //Timers on the header, later ones are left out of the file
+	long long frame = 0;
+};
+
+const int traceBufferEvents = 1 << 16; //Per thread, the oldest events are overwritten
+
+//One scope of a thread, in ns since the start of the Tracer
+struct TraceEvent {
+	const char *name;
+	long long begin, end;
+};
+
+//Events of one thread. Only that thread writes, so a ring with an atomic count of written events is enough
+struct TraceBuffer {
+	TraceEvent events[traceBufferEvents];
+	std::atomic<long long> written{ 0 };
+	std::atomic<bool> inUse{ true };
+	int id = 0;
+	std::string name;
+};
+
+//Scopes of every thread, written as Chrome trace JSON (chrome://tracing, Perfetto). Threads get their buffer on
+//their first event, and leave it to the next new thread when they exit. The next thread starts it empty
+class Tracer {
+public:
+	static Tracer &instance();
+
+	void start(); //Drops the events recorded before
+	void stop();
+	bool recording() const { return active.load(std::memory_order_relaxed); }
+	bool write(const char *path); //Stops the recording, the scopes still open are left out
+
+	void record(const char *name, std::chrono::high_resolution_clock::time_point begin, std::chrono::high_resolution_clock::time_point end);
+	static void nameThread(const char *name);
+	static const char *currentScope(); //Innermost scope of the calling thread, the name of the pool jobs it starts
+	static void setCurrentScope(const char *name);
+
+private:
+	Tracer() : epoch(std::chrono::high_resolution_clock::now()) {}
+	TraceBuffer *threadBuffer();
+
+	std::atomic<bool> active{ false };
+	std::chrono::high_resolution_clock::time_point epoch;
+	std::mutex mutex; //Buffers of new threads and writing
+	std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
+
+//An event of the trace from its construction to its destruction, when the Tracer records
+class TraceScope {
+public:
+	explicit TraceScope(const char *name) : name(name), traced(Tracer::instance().recording()) {
+		if (traced) { start = std::chrono::high_resolution_clock::now(); }
+	}
+	~TraceScope() {
+		if (traced) { Tracer::instance().record(name, start, std::chrono::high_resolution_clock::now()); }
+	}
+
+private:
+	const char *name;
+	bool traced;
+	std::chrono::high_resolution_clock::time_point start;
+};
+
+//Adds the time from its construction to its destruction to a timer
+class ProfileScope {
+public:
+	explicit ProfileScope(int timer) : timer(timer), outer(Tracer::currentScope()), start(std::chrono::high_resolution_clock::now()) {
+		Tracer::setCurrentScope(Profiler::instance().name(timer));
+	}
+	~ProfileScope() {
+		auto end = std::chrono::high_resolution_clock::now();
+		Profiler::instance().add(timer, std::chrono::duration<float, std::milli>(end - start).count());
+		if (Tracer::instance().recording()) { Tracer::instance().record(Profiler::instance().name(timer), start, end); }
+		Tracer::setCurrentScope(outer);
+	}
+
+private:
+	int timer;
+	const char *outer;
+	std::chrono::high_resolution_clock::time_point start;
+};
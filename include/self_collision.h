@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "cloth_bvh.h"
+#include "particle_state.h"
+#include "springs.h"
+#include "thread_pool.h"
+
+//Work of the last self-collision pass
+struct SelfCollisionStats {
+	long long pairsTested = 0; //Node-triangle tests
+	int contacts = 0;
+	int impacts = 0; //Contacts only found by the continuous tests
+	float maxCorrection = 0; //Longest move of a node
+	int cells = 0; //Hash buckets
+};
+
+//Structure the candidate node-triangle pairs come from
+enum class SelfCollisionBroadphase { SpatialHash = 0, BVH = 1 };
+
+struct SelfCollisionParams {
+	float thickness;
+	float cellSize; //Of the spatial hash
+	bool continuous;
+	SelfCollisionBroadphase broadphase;
+};
+
+//Keeps the nodes at "thickness" from the triangles of the cloth. Triangles grown by the thickness are put on a uniform
+//spatial hash, rebuilt every step with a counting sort over reused arrays, or looked up on the refitted BVH of the cloth.
+//Every node is only tested against the triangles of its cells or of the leaves its box overlaps, and triangles with a
+//vertex that is the node or one of its spring neighbors are skipped.
+//Nodes go in parallel chunks of the grid, which are patches of neighboring cells. Corrections are computed from the
+//positions before the pass (Jacobi) and applied after, so the result doesn't depend on the number of threads. A contact
+//moves the node by half of the separation and the triangle or the edge by the other half, at the contact point.
+//The side of a triangle a node is on comes from the last positions, so nodes that crossed a triangle during the step are
+//pushed back. With "continuous", nodes and triangles cover the boxes of their whole motion on the step, and nodes and edges
+//that went through a triangle or an edge far from where they ended are also found (vertex-triangle and edge-edge, see ccd.h)
+class SelfCollision {
+public:
+	//The triangles come from "bvh", refitted on the same positions and swept with "continuous"
+	void solve(ParticleState &state, const std::vector<Spring> &springs, const ClothBVH &bvh, const SelfCollisionParams &params, ThreadPool &pool);
+
+	const SelfCollisionStats &stats() const { return lastStats; }
+
+private:
+	void buildTopology(const ClothBVH &bvh, int n, const std::vector<Spring> &springs);
+	void buildHash(const ClothBVH &bvh, float cellSize, ThreadPool &pool);
+
+	//Topology, rebuilt when the grid or the springs change
+	ClothGrid topologyGrid = { 0, 0 };
+	size_t topologySprings = 0;
+	std::vector<int> neighborStart; //Spring neighbors of every node
+	std::vector<int> neighbors;
+	std::vector<int> edgeStart, edgeNodes; //Triangle edges of every node
+	std::vector<unsigned char> ownedEdges; //Edges (bits) every triangle tests, an edge shared by two triangles goes on the first one
+
+	std::vector<glm::vec3> nodeBounds; //Box of every node on the step, low and high corners
+	std::vector<glm::vec3> triangleBounds; //Box of every triangle grown by the thickness, low and high corners
+
+	//Spatial hash, a power of two of buckets
+	int tableMask = 0;
+	std::vector<glm::ivec3> nodeLow, nodeHigh; //Cells covered by every node
+	std::vector<glm::ivec3> triangleLow, triangleHigh; //Cells covered by every triangle
+	std::vector<int> triangleStart, sortedTriangles; //Triangles by bucket
+	std::vector<int> next;
+
+	//A node pushed away from a triangle or an edge, which gets the opposite push at the contact point
+	struct SelfContact {
+		int node;
+		glm::ivec3 others; //Nodes of the triangle, or of the edge and -1
+		glm::vec3 weights; //Of the contact point on the others
+		glm::vec3 push;
+	};
+	std::vector<std::vector<SelfContact>> contactLists; //Of every chunk of nodes
+	std::vector<glm::vec3> pushSum;
+	std::vector<int> pushCount;
+
+	std::vector<glm::vec3> correction;
+	SelfCollisionStats lastStats;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "particle_state.h"
+#include "springs.h"
+#include "colliders.h"
+
+//Instruction set used by the kernels. AVX2 and SSE are only available when the compiler targets them
+enum class KernelPath { Scalar = 0, SSE = 1, AVX2 = 2 };
+
+KernelPath bestKernelPath(); //Widest path compiled in
+const char *kernelPathName(KernelPath path);
+
+//Adds the stiffness and damping forces of "count" springs to both of their nodes
+void accumulateSpringForces(KernelPath path, const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force, const Spring *springs, int count, float Ke, float Kd);
+//Same on a double state, scalar only: the double lanes don't gather
+void accumulateSpringForcesDouble(const SoAVec3Double &pos, const SoAVec3Double &vel, SoAVec3Double &force, const Spring *springs, int count, float Ke, float Kd);
+
+//Integration kernels over all the nodes of the state (padding included). Acceleration is w * (f + g), fixed nodes have w = 0
+//Explicit Euler: x += dt * v, v += dt * a
+void integrateExplicitEuler(KernelPath path, ParticleState &state, float dt, glm::vec3 gravity);
+//Symplectic Euler: v += dt * a, x += dt * v
+void integrateSymplecticEuler(KernelPath path, ParticleState &state, float dt, glm::vec3 gravity);
+//Position Verlet, "last" is the previous position: x' = 2x - last + dt^2 * a, v = (x' - x) / dt
+void integrateVerlet(KernelPath path, ParticleState &state, float dt, glm::vec3 gravity);
+
+//One RK4 stage evaluated on (stagePos, stageVel, stageForce):
+//sumPos += weight * stageVel, sumVel += weight * a, then the next stage state is stagePos = x + next * stageVel, stageVel = v + next * a
+void rk4Stage(KernelPath path, const ParticleState &state, SoAVec3 &stagePos, SoAVec3 &stageVel, const SoAVec3 &stageForce, SoAVec3 &sumPos, SoAVec3 &sumVel, float weight, float next, glm::vec3 gravity);
+//Last RK4 step: last = x, x += dt / 6 * sumPos, v += dt / 6 * sumVel
+void rk4Finish(KernelPath path, ParticleState &state, const SoAVec3 &sumPos, const SoAVec3 &sumVel, float dt);
+
+//Collision response of the nodes [begin, end) (multiples of simdWidth) against all the colliders, in order.
+//Fixed nodes don't move. "last" is mirrored with the position so Verlet keeps the bounce.
+//With "swept", spheres and capsules test the motion of the nodes on the step (from "last", relative to the collider moving
+//with its velocity for "dt"), so fast nodes and fast colliders don't go through them. Planes and boxes are half-spaces and
+//already catch any node that ends on the wrong side
+void collideNodes(KernelPath path, ParticleState &state, int begin, int end, const Collider *colliders, int count, float dt, bool swept);
+
+//Ensembles of cloths with the same mesh, "lanes" instances interleaved: node i of instance l is at i * lanes + l (AoSoA).
+//"lanes" is a multiple of the width of the path (8 with AVX2), per-instance parameters are arrays of "lanes" floats
+const int maxEnsembleLanes = 16;
+//Spring forces with the stiffness and damping of every instance, added to "force"
+void accumulateEnsembleForces(KernelPath path, const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force, const Spring *springs, int count, const float *Ke, const float *Kd, int lanes);
+//Gauss-Seidel strain limiting, as limitStrain with max length restLength * maxScale[l]. "lanes" is at most maxEnsembleLanes
+void limitEnsembleStrain(KernelPath path, SoAVec3 &pos, const float *invMass, const Spring *springs, int count, const float *maxScale, int lanes, int iterations, float tolerance);
+//collideNodes over the whole state, every collider responding with the elasticity of each instance
+void collideEnsembleNodes(KernelPath path, ParticleState &state, const Collider *colliders, int count, const float *elasticity, int lanes, float dt, bool swept);
@@ -0,0 +1,129 @@
+#pragma once
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CLOTH_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLOTH_SSE
+#endif
+
+//Lane types of the kernel sources: every kernel is written once over these operations and instantiated per instruction set.
+//The rest of the solver picks an instruction set with KernelPath (simd_kernels.h). T is the scalar type of the lanes,
+//the double ones only have the arithmetic of the grid kernels
+template <class Real>
+struct BasicScalarLanes {
+	typedef Real T;
+	typedef Real V;
+	typedef int I;
+	static const int width = 1;
+	static V load(const Real *p) { return *p; }
+	static V loadu(const Real *p) { return *p; }
+	static void store(Real *p, V v) { *p = v; }
+	static void storeu(Real *p, V v) { *p = v; }
+	static V set1(Real f) { return f; }
+	static V add(V a, V b) { return a + b; }
+	static V sub(V a, V b) { return a - b; }
+	static V mul(V a, V b) { return a * b; }
+	static V div(V a, V b) { return a / b; }
+	static V sqrt(V a) { return std::sqrt(a); }
+	static V min(V a, V b) { return a < b ? a : b; }
+	static V max(V a, V b) { return a > b ? a : b; }
+	static V lessThan(V a, V b) { return a < b ? (Real)1 : (Real)0; } //Masks
+	static V both(V a, V b) { return a * b; }
+	static V select(V mask, V a, V b) { return mask != 0 ? a : b; }
+	static bool any(V mask) { return mask != 0; }
+	static I springIndices(const int *record) { return record[0]; } //Node field of "width" spring records
+	static V gather(const Real *base, I index) { return base[index]; }
+	static V loadStride4(const float *p) { return p[0]; }
+};
+
+typedef BasicScalarLanes<float> ScalarLanes;
+typedef BasicScalarLanes<double> ScalarLanesDouble;
+
+#if defined(CLOTH_SSE)
+struct SSELanes {
+	typedef float T;
+	typedef __m128 V;
+	typedef const int *I; //No gather on SSE, lanes are loaded one by one from the records
+	static const int width = 4;
+	static V load(const float *p) { return _mm_load_ps(p); }
+	static V loadu(const float *p) { return _mm_loadu_ps(p); }
+	static void store(float *p, V v) { _mm_store_ps(p, v); }
+	static void storeu(float *p, V v) { _mm_storeu_ps(p, v); }
+	static V set1(float f) { return _mm_set1_ps(f); }
+	static V add(V a, V b) { return _mm_add_ps(a, b); }
+	static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+	static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+	static V div(V a, V b) { return _mm_div_ps(a, b); }
+	static V sqrt(V a) { return _mm_sqrt_ps(a); }
+	static V min(V a, V b) { return _mm_min_ps(a, b); }
+	static V max(V a, V b) { return _mm_max_ps(a, b); }
+	static V lessThan(V a, V b) { return _mm_cmplt_ps(a, b); }
+	static V both(V a, V b) { return _mm_and_ps(a, b); }
+	static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	static bool any(V mask) { return _mm_movemask_ps(mask) != 0; }
+	static I springIndices(const int *record) { return record; }
+	static V gather(const float *base, I r) { return _mm_setr_ps(base[r[0]], base[r[4]], base[r[8]], base[r[12]]); }
+	static V loadStride4(const float *p) { return _mm_setr_ps(p[0], p[4], p[8], p[12]); }
+};
+
+struct SSELanesDouble {
+	typedef double T;
+	typedef __m128d V;
+	static const int width = 2;
+	static V loadu(const double *p) { return _mm_loadu_pd(p); }
+	static void storeu(double *p, V v) { _mm_storeu_pd(p, v); }
+	static V set1(double f) { return _mm_set1_pd(f); }
+	static V add(V a, V b) { return _mm_add_pd(a, b); }
+	static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+	static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+	static V div(V a, V b) { return _mm_div_pd(a, b); }
+	static V sqrt(V a) { return _mm_sqrt_pd(a); }
+};
+#endif
+
+#if defined(CLOTH_AVX2)
+struct AVX2Lanes {
+	typedef float T;
+	typedef __m256 V;
+	typedef __m256i I;
+	static const int width = 8;
+	static V load(const float *p) { return _mm256_load_ps(p); }
+	static V loadu(const float *p) { return _mm256_loadu_ps(p); }
+	static void store(float *p, V v) { _mm256_store_ps(p, v); }
+	static void storeu(float *p, V v) { _mm256_storeu_ps(p, v); }
+	static V set1(float f) { return _mm256_set1_ps(f); }
+	static V add(V a, V b) { return _mm256_add_ps(a, b); }
+	static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+	static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	static V div(V a, V b) { return _mm256_div_ps(a, b); }
+	static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+	static V min(V a, V b) { return _mm256_min_ps(a, b); }
+	static V max(V a, V b) { return _mm256_max_ps(a, b); }
+	static V lessThan(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static V both(V a, V b) { return _mm256_and_ps(a, b); }
+	static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+	static bool any(V mask) { return _mm256_movemask_ps(mask) != 0; }
+	static __m256i stride4() { return _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28); }
+	static I springIndices(const int *record) { return _mm256_i32gather_epi32(record, stride4(), 4); }
+	static V gather(const float *base, I index) { return _mm256_i32gather_ps(base, index, 4); }
+	static V loadStride4(const float *p) { return _mm256_i32gather_ps(p, stride4(), 4); }
+};
+
+struct AVX2LanesDouble {
+	typedef double T;
+	typedef __m256d V;
+	static const int width = 4;
+	static V loadu(const double *p) { return _mm256_loadu_pd(p); }
+	static void storeu(double *p, V v) { _mm256_storeu_pd(p, v); }
+	static V set1(double f) { return _mm256_set1_pd(f); }
+	static V add(V a, V b) { return _mm256_add_pd(a, b); }
+	static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+	static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+	static V div(V a, V b) { return _mm256_div_pd(a, b); }
+	static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+};
+#endif
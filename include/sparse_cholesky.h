@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+//Sparse Cholesky factorization A = L L' of a symmetric positive definite matrix.
+//The matrix is given already permuted with a fill-reducing ordering, the factor keeps its pattern.
+class SparseCholesky {
+public:
+	//Factorizes the upper triangular part (row <= column) of the matrix, in compressed columns.
+	//Returns false if the matrix is not positive definite
+	bool factor(int n, const std::vector<int> &columnStart, const std::vector<int> &row, const std::vector<double> &value);
+
+	//Solves L L' x = b in place, for the three coordinates at once
+	void solve(glm::dvec3 *x) const;
+
+	int size() const { return n; }
+	size_t nonZeros() const { return Lx.size(); }
+
+private:
+	int n = 0;
+	std::vector<int> parent; //Elimination tree
+	std::vector<int> Lp;     //Columns of L, the diagonal is the first entry of each one
+	std::vector<int> Li;
+	std::vector<double> Lx;
+};
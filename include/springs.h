@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+
+//Type of spring joining two nodes of the mesh
+enum class SpringKind { Structural = 0, Shear = 1, Bending = 2 };
+
+//One spring of the mesh, the force is evaluated once and applied to both ends
+struct Spring {
+	int i, j; //Nodes joined by the spring (i < j)
+	float restLength;
+	SpringKind kind;
+};
+
+//Builds the flat list of structural, shear and bending springs of a rows x columns mesh with "L" separation
+void buildSprings(std::vector<Spring> &springs, int rows, int columns, float L);
+
+//Rest lengths of a built list for a new "L" separation, the same a new build would give. Order and colors are kept
+void setRestLengths(std::vector<Spring> &springs, float L);
+
+//Sorts the springs by color: springs of the same color never share a node, so a color can be evaluated in parallel without locks.
+//Color c holds the springs [colorOffsets[c], colorOffsets[c + 1])
+void colorSprings(std::vector<Spring> &springs, int totalVertex, std::vector<int> &colorOffsets);
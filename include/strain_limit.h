@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "springs.h"
+#include "particle_state.h"
+#include "thread_pool.h"
+
+//Order in which the spring corrections are applied
+enum class StrainOrdering { Jacobi = 0, GaussSeidel = 1 };
+
+struct StrainLimitParams {
+	float maxElongation; //Max elongation over the rest length, as a fraction (0.5 = 50%)
+	float tolerance; //Sweeps stop once no spring is longer than its max length by more than this fraction of its rest length
+	int iterations; //Max sweeps
+	StrainOrdering ordering;
+};
+
+//Buffers of the Jacobi ordering, reused between steps. Every cloth has its own, cloths of a world are limited at once
+template <class Real>
+struct BasicStrainScratch {
+	std::vector<glm::tvec3<Real>> delta;
+	std::vector<int> count;
+};
+
+typedef BasicStrainScratch<float> StrainScratch;
+typedef BasicStrainScratch<double> StrainScratchDouble;
+
+//Strain limiting stage, run once per step after the integration.
+//Clamps every structural and shear spring to its max length, moving its nodes weighted by their inverse mass (0 = fixed node).
+//"springs" is sorted by color ("colors" are the offsets, see colorSprings): the springs of a color don't share nodes, so every
+//color is split between the threads of "pool" and the result is the same as in order on one thread.
+//Cost is linear on the number of springs times the sweeps, returns the sweeps done. Instantiated for the float and the double positions.
+template <class Real>
+int limitStrain(BasicSoAVec3<Real> &positions, const float invMass[], int totalVertex, const std::vector<Spring> &springs, const std::vector<int> &colors,
+	const StrainLimitParams &params, BasicStrainScratch<Real> &scratch, ThreadPool &pool);
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//Persistent worker threads for the physics. The calling thread also takes part on every job
+class ThreadPool {
+public:
+	ThreadPool() = default;
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool &operator=(const ThreadPool&) = delete;
+
+	//Total threads used by a job, including the caller (1 = run everything on the caller)
+	void setThreadCount(int threads);
+	int threadCount() const { return (int)workers.size() + 1; }
+
+	//Runs task(begin, end) over [0, count) in chunks of "grain" and returns when all of them are done
+	void parallelFor(int count, int grain, const std::function<void(int begin, int end)> &task);
+
+private:
+	void workerLoop();
+	void runChunks(const std::function<void(int, int)> &task, int count, int grain, const char *name);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	//Current job, published under the mutex
+	const std::function<void(int, int)> *job = nullptr;
+	int jobCount = 0;
+	int jobGrain = 1;
+	const char *jobName = nullptr; //Scope of the caller, for the trace
+	unsigned generation = 0;
+	int activeWorkers = 0;
+	bool quit = false;
+
+	std::atomic<int> nextChunk{ 0 };
+	std::atomic<int> pendingChunks{ 0 };
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//Persistent threads for independent tasks of uneven cost, like the cloths of a world. Every thread has a deque
+//of tasks: it takes them from its front, and when it runs out it steals from the back of the others.
+//The calling thread is thread 0 and also takes part on every run
+class WorkStealingPool {
+public:
+	WorkStealingPool() = default;
+	~WorkStealingPool();
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool &operator=(const WorkStealingPool&) = delete;
+
+	void setThreadCount(int threads); //Including the caller
+	int threadCount() const { return (int)workers.size() + 1; }
+
+	//Runs task(i) for every i of "order" and returns when all of them are done. They are dealt to the threads
+	//in turns in that order, so the most expensive first balances them before any stealing
+	void run(const std::vector<int> &order, const std::function<void(int task)> &task);
+
+	long long steals() const { return stolen; } //Tasks taken from another thread on the last run
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<int> tasks;
+	};
+
+	void workerLoop(int thread);
+	void runTasks(int thread, const std::function<void(int)> &task);
+	bool takeTask(int thread, int &task);
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<Queue>> queues; //One per thread
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	//Current run, published under the mutex
+	const std::function<void(int)> *job = nullptr;
+	unsigned generation = 0;
+	int activeWorkers = 0;
+	bool quit = false;
+
+	std::atomic<int> pendingTasks{ 0 };
+	std::atomic<long long> stolen{ 0 };
+};
@@ -0,0 +1,317 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <functional>
+
+#include "cloth_simulation.h"
+#include "grid_kernels.h"
+
+//Benchmarks of the physics hot paths over grid sizes, thread counts and solver modes. Results are written as JSON
+//and compared with a saved baseline, the exit code is 2 when a case is slower than the baseline by more than the tolerance
+
+namespace {
+
+	struct BenchmarkResult {
+		std::string name;
+		ClothGrid grid;
+		int threads;
+		std::string integrator; //Empty for the stages that don't depend on it
+		double medianMs;
+		double minMs;
+		int samples;
+	};
+
+	struct BenchmarkOptions {
+		std::vector<ClothGrid> grids = { { 18, 14 }, { 64, 64 }, { 256, 256 }, { 1024, 1024 } };
+		std::vector<int> threads;
+		std::vector<IntegratorType> integrators = { IntegratorType::SymplecticEuler, IntegratorType::ImplicitEuler, IntegratorType::XPBD, IntegratorType::ProjectiveDynamics };
+		std::vector<Precision> precisions = { Precision::Float, Precision::Mixed, Precision::Double };
+		double minTimeMs = 200; //Per case
+		int minSamples = 5;
+		int warmupSteps = 5;
+		int maxPDNodes = 256 * 256; //The factorization of bigger grids takes minutes and gigabytes
+		const char *output = nullptr;
+		const char *baseline = nullptr;
+		double tolerance = 0.15;
+		bool useSimd = true;
+	};
+
+	//Runs "run" until it took minTimeMs and minSamples, and keeps the median and the min of the samples
+	BenchmarkResult measure(const std::function<void()> &run, const BenchmarkOptions &options) {
+
+		std::vector<double> samples;
+		double total = 0;
+		while ((total < options.minTimeMs || (int)samples.size() < options.minSamples) && samples.size() < 10000) {
+			auto start = std::chrono::high_resolution_clock::now();
+			run();
+			double sample = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			samples.push_back(sample);
+			total += sample;
+		}
+		std::sort(samples.begin(), samples.end());
+
+		BenchmarkResult result = {};
+		result.medianMs = samples[samples.size() / 2];
+		result.minMs = samples[0];
+		result.samples = (int)samples.size();
+		return result;
+	}
+
+	std::string gridName(ClothGrid grid) {
+
+		return std::to_string(grid.rows) + "x" + std::to_string(grid.columns);
+	}
+
+	std::string resultKey(const BenchmarkResult &result) {
+
+		return result.name + "|" + gridName(result.grid) + "|" + std::to_string(result.threads) + "|" + result.integrator;
+	}
+
+	void addResult(std::vector<BenchmarkResult> &results, BenchmarkResult result, const char *name, const ClothSimulation &simulation, const char *integrator) {
+
+		result.name = name;
+		result.grid = simulation.grid;
+		result.threads = simulation.params.threads;
+		result.integrator = integrator;
+		results.push_back(result);
+
+		double nodeSteps = simulation.grid.totalVertex() / (result.medianMs / 1000);
+		printf("%-22s %-10s %2d threads %-17s %10.3f ms median %10.3f ms min %12.0f nodes/s\n", name, gridName(result.grid).c_str(),
+			result.threads, integrator, result.medianMs, result.minMs, nodeSteps);
+		fflush(stdout);
+	}
+
+	void benchmarkGrid(ClothGrid grid, int threads, const BenchmarkOptions &options, std::vector<BenchmarkResult> &results) {
+
+		ClothSimulation simulation;
+		simulation.params.threads = threads;
+		simulation.params.useSimd = options.useSimd;
+		simulation.allocate(grid);
+		simulation.pool.setThreadCount(threads);
+		for (int i = 0; i < options.warmupSteps; i++) { simulation.step(1.f / 60); } //Away from the flat rest state
+
+		//Single pass over all the springs on one thread
+		ParticleState &nodes = simulation.nodes;
+		KernelPath path = simulation.kernelPath();
+		addResult(results, measure([&]() {
+			nodes.clearForces();
+			accumulateSpringForces(path, nodes.pos, nodes.vel, nodes.force, simulation.springs.data(), (int)simulation.springs.size(), (float)simulation.params.Ke, simulation.params.Kd);
+		}, options), "calculateForces", simulation, "");
+
+		//The same springs as a stencil over the grid, on one thread
+		GridForceKernel gridKernel = gridForceKernel(path, grid);
+		float L = simulation.springsL;
+		GridSpringParams springParams = { L, sqrtf(L*L + L*L), L * 2, (float)simulation.params.Ke, simulation.params.Kd };
+		addResult(results, measure([&]() {
+			nodes.clearForces();
+			gridKernel(nodes.pos, nodes.vel, nodes.force, grid, 0, grid.rows, springParams);
+		}, options), "gridForces", simulation, "");
+
+		addResult(results, measure([&]() { simulation.calculateAllForces(nodes.pos, nodes.vel, nodes.force); }, options), "calculateAllForces", simulation, "");
+		addResult(results, measure([&]() { simulation.checkElongation(); }, options), "checkElongation", simulation, "");
+		addResult(results, measure([&]() { simulation.refitBVH(); }, options), "refitBVH", simulation, "");
+		addResult(results, measure([&]() { simulation.calculateSelfCollisions(); }, options), "calculateSelfCollisions", simulation, "");
+		addResult(results, measure([&]() { simulation.calculateAllCollisions(1.f / 60); }, options), "calculateAllCollisions", simulation, "");
+
+		for (IntegratorType type : options.integrators) {
+			if (type == IntegratorType::ProjectiveDynamics && grid.totalVertex() > options.maxPDNodes) {
+				printf("%-22s %-10s %2d threads %-17s skipped, more than %d nodes\n", "PhysicsUpdate", gridName(grid).c_str(), threads, integratorOption(type), options.maxPDNodes);
+				continue;
+			}
+			simulation.params.integrator = type;
+			for (Precision precision : options.precisions) {
+				//Integrators without the precision would repeat a case. Float keeps the name of the cases before the precisions
+				simulation.params.precision = precision;
+				if (simulation.activePrecision() != precision) { continue; }
+				std::string name = integratorOption(type);
+				if (precision != Precision::Float) { name = name + "/" + precisionOption(precision); }
+
+				simulation.reset();
+				for (int i = 0; i < options.warmupSteps; i++) { simulation.step(1.f / 60); } //Creates the integrator and its caches
+				addResult(results, measure([&]() { simulation.step(1.f / 60); }, options), "PhysicsUpdate", simulation, name.c_str());
+			}
+		}
+		simulation.params.precision = Precision::Float;
+
+		simulation.release();
+	}
+
+	void writeJson(const char *path, const std::vector<BenchmarkResult> &results) {
+
+		FILE *file = fopen(path, "w");
+		if (!file) {
+			fprintf(stderr, "Can't write %s\n", path);
+			return;
+		}
+
+		//One result per line, loadBaseline reads them back
+		fprintf(file, "{\n  \"kernels\": \"%s\",\n  \"results\": [\n", kernelPathName(bestKernelPath()));
+		for (size_t i = 0; i < results.size(); i++) {
+			const BenchmarkResult &result = results[i];
+			fprintf(file, "    {\"name\": \"%s\", \"grid\": \"%s\", \"threads\": %d, \"integrator\": \"%s\", \"median_ms\": %.6f, \"min_ms\": %.6f, \"samples\": %d}%s\n",
+				result.name.c_str(), gridName(result.grid).c_str(), result.threads, result.integrator.c_str(), result.medianMs, result.minMs, result.samples,
+				i + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "  ]\n}\n");
+		fclose(file);
+	}
+
+	//Value of "key" on a result line, as written by writeJson
+	std::string jsonValue(const std::string &line, const char *key) {
+
+		std::string pattern = std::string("\"") + key + "\": ";
+		size_t start = line.find(pattern);
+		if (start == std::string::npos) { return ""; }
+		start += pattern.size();
+		if (line[start] == '"') {
+			size_t end = line.find('"', start + 1);
+			return line.substr(start + 1, end - start - 1);
+		}
+		size_t end = line.find_first_of(",}", start);
+		return line.substr(start, end - start);
+	}
+
+	bool loadBaseline(const char *path, std::map<std::string, double> &baseline) {
+
+		FILE *file = fopen(path, "r");
+		if (!file) { return false; }
+
+		char buffer[1024];
+		while (fgets(buffer, sizeof(buffer), file)) {
+			std::string line = buffer;
+			if (line.find("\"median_ms\"") == std::string::npos) { continue; }
+			std::string key = jsonValue(line, "name") + "|" + jsonValue(line, "grid") + "|" + jsonValue(line, "threads") + "|" + jsonValue(line, "integrator");
+			baseline[key] = atof(jsonValue(line, "median_ms").c_str());
+		}
+		fclose(file);
+		return true;
+	}
+
+	//Prints the cases slower than the baseline and returns how many
+	int compareBaseline(const std::vector<BenchmarkResult> &results, const std::map<std::string, double> &baseline, double tolerance) {
+
+		int regressions = 0, compared = 0;
+		for (const BenchmarkResult &result : results) {
+			auto found = baseline.find(resultKey(result));
+			if (found == baseline.end() || found->second <= 0) { continue; }
+			compared++;
+			double change = result.medianMs / found->second - 1;
+			if (change > tolerance) {
+				printf("REGRESSION %-22s %-10s %2d threads %-17s %.3f ms -> %.3f ms (%+.1f%%)\n", result.name.c_str(), gridName(result.grid).c_str(),
+					result.threads, result.integrator.c_str(), found->second, result.medianMs, 100 * change);
+				regressions++;
+			}
+		}
+		printf("%d cases compared with the baseline, %d regressions over %.0f%%\n", compared, regressions, 100 * tolerance);
+		return regressions;
+	}
+
+	bool parseList(const char *value, std::vector<std::string> &items) {
+
+		items.clear();
+		std::string list = value;
+		size_t start = 0;
+		while (start < list.size()) {
+			size_t end = list.find(',', start);
+			if (end == std::string::npos) { end = list.size(); }
+			items.push_back(list.substr(start, end - start));
+			start = end + 1;
+		}
+		return !items.empty();
+	}
+
+	void printUsage(const char *program) {
+
+		printf("Usage: %s [options]\n", program);
+		printf("  --grids LIST       Comma separated rowsxcolumns (18x14,64x64,256x256,1024x1024)\n");
+		printf("  --threads LIST     Comma separated thread counts (1 and all)\n");
+		printf("  --integrators LIST Comma separated solver modes for the full step (symplectic,implicit,xpbd,pd)\n");
+		printf("  --precisions LIST  Comma separated precisions of the full step (float,mixed,double), skipped by the solver modes without them\n");
+		printf("  --min-time MS      Minimum time per case (200)\n");
+		printf("  --output FILE      Write the results as JSON\n");
+		printf("  --baseline FILE    Compare with the JSON of a previous run\n");
+		printf("  --tolerance F      Allowed slowdown over the baseline median (0.15)\n");
+		printf("  --scalar           Use the scalar kernels instead of SIMD\n");
+	}
+}
+
+int main(int argc, char **argv) {
+
+	BenchmarkOptions options;
+	int hardwareThreads = glm::max(1, (int)std::thread::hardware_concurrency());
+	options.threads.push_back(1);
+	if (hardwareThreads > 1) { options.threads.push_back(hardwareThreads); }
+
+	for (int i = 1; i < argc; i++) {
+		const char *option = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		std::vector<std::string> items;
+
+		if (strcmp(option, "--scalar") == 0) { options.useSimd = false; continue; }
+		if (strcmp(option, "--help") == 0) { printUsage(argv[0]); return 0; }
+		if (!value) {
+			fprintf(stderr, "Missing value for %s\n", option);
+			return 1;
+		}
+		i++;
+
+		if (strcmp(option, "--grids") == 0) {
+			if (!parseGridList(value, options.grids)) { fprintf(stderr, "Bad grid list %s\n", value); return 1; }
+		}
+		else if (strcmp(option, "--threads") == 0) {
+			parseList(value, items);
+			options.threads.clear();
+			for (const std::string &item : items) { options.threads.push_back(glm::max(1, atoi(item.c_str()))); }
+		}
+		else if (strcmp(option, "--integrators") == 0) {
+			parseList(value, items);
+			options.integrators.clear();
+			for (const std::string &item : items) {
+				IntegratorType type;
+				if (!parseIntegratorOption(item.c_str(), type)) { fprintf(stderr, "Unknown integrator %s\n", item.c_str()); return 1; }
+				options.integrators.push_back(type);
+			}
+		}
+		else if (strcmp(option, "--precisions") == 0) {
+			parseList(value, items);
+			options.precisions.clear();
+			for (const std::string &item : items) {
+				Precision precision;
+				if (!parsePrecisionOption(item.c_str(), precision)) { fprintf(stderr, "Unknown precision %s\n", item.c_str()); return 1; }
+				options.precisions.push_back(precision);
+			}
+		}
+		else if (strcmp(option, "--min-time") == 0) { options.minTimeMs = atof(value); }
+		else if (strcmp(option, "--output") == 0) { options.output = value; }
+		else if (strcmp(option, "--baseline") == 0) { options.baseline = value; }
+		else if (strcmp(option, "--tolerance") == 0) { options.tolerance = atof(value); }
+		else {
+			fprintf(stderr, "Unknown option %s\n", option);
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::map<std::string, double> baseline;
+	if (options.baseline && !loadBaseline(options.baseline, baseline)) {
+		fprintf(stderr, "Can't read the baseline %s\n", options.baseline);
+		return 1;
+	}
+
+	printf("%s kernels, %d hardware threads\n", kernelPathName(options.useSimd ? bestKernelPath() : KernelPath::Scalar), hardwareThreads);
+	std::vector<BenchmarkResult> results;
+	for (ClothGrid grid : options.grids) {
+		for (int threads : options.threads) {
+			benchmarkGrid(grid, threads, options, results);
+		}
+	}
+
+	if (options.output) { writeJson(options.output, results); }
+	if (options.baseline && compareBaseline(results, baseline, options.tolerance) > 0) { return 2; }
+	return 0;
+}
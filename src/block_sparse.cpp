@@ -0,0 +1,90 @@
+#include <cmath>
+
+#include "block_sparse.h"
+
+namespace {
+	const int rowGrain = 4096; //Rows per parallel task and per partial sum
+
+	double parallelDot(const glm::vec3 *a, const glm::vec3 *b, int n, ThreadPool &pool) {
+
+		std::vector<double> partial((n + rowGrain - 1) / rowGrain, 0.0);
+		pool.parallelFor(n, rowGrain, [&](int begin, int end) {
+			double sum = 0;
+			for (int i = begin; i < end; i++) { sum += glm::dot(a[i], b[i]); }
+			partial[begin / rowGrain] = sum;
+		});
+
+		double total = 0;
+		for (double sum : partial) { total += sum; }
+		return total;
+	}
+}
+
+void BlockSparseMatrix::multiply(const glm::vec3 *x, glm::vec3 *y, ThreadPool &pool) const {
+
+	pool.parallelFor(rows, rowGrain, [&](int begin, int end) {
+		for (int r = begin; r < end; r++) {
+			glm::vec3 sum(0, 0, 0);
+			for (int e = rowStart[r]; e < rowStart[r + 1]; e++) { sum += blocks[e] * x[column[e]]; }
+			y[r] = sum;
+		}
+	});
+}
+
+CGResult solvePCG(const BlockSparseMatrix &A, const glm::vec3 *b, glm::vec3 *x, const float *filter, float tolerance, int maxIterations, ThreadPool &pool) {
+
+	const int n = A.rows;
+	std::vector<glm::vec3> r(n), z(n), p(n), q(n);
+	std::vector<glm::mat3> preconditioner(n);
+
+	//r = S(b - Ax), z = P r
+	pool.parallelFor(n, rowGrain, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) { x[i] *= filter[i]; }
+	});
+	A.multiply(x, q.data(), pool);
+	pool.parallelFor(n, rowGrain, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			r[i] = filter[i] * (b[i] - q[i]);
+			preconditioner[i] = filter[i] * glm::inverse(A.blocks[A.diagonal[i]]);
+			z[i] = preconditioner[i] * r[i];
+			p[i] = z[i];
+		}
+	});
+
+	double bNorm = sqrt(parallelDot(b, b, n, pool));
+	if (bNorm == 0) { bNorm = 1; }
+	double rz = parallelDot(r.data(), z.data(), n, pool);
+	double residual = sqrt(parallelDot(r.data(), r.data(), n, pool)) / bNorm;
+
+	int iteration = 0;
+	while (iteration < maxIterations && residual > tolerance) {
+		A.multiply(p.data(), q.data(), pool);
+		pool.parallelFor(n, rowGrain, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) { q[i] *= filter[i]; }
+		});
+
+		double pq = parallelDot(p.data(), q.data(), n, pool);
+		if (pq <= 0) { break; } //Not positive definite any more, keep the current solution
+		float alpha = (float)(rz / pq);
+
+		pool.parallelFor(n, rowGrain, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				x[i] += alpha * p[i];
+				r[i] -= alpha * q[i];
+				z[i] = preconditioner[i] * r[i];
+			}
+		});
+		iteration++;
+
+		residual = sqrt(parallelDot(r.data(), r.data(), n, pool)) / bNorm;
+		double rzNext = parallelDot(r.data(), z.data(), n, pool);
+		float beta = (float)(rzNext / rz);
+		rz = rzNext;
+
+		pool.parallelFor(n, rowGrain, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) { p[i] = z[i] + beta * p[i]; }
+		});
+	}
+
+	return { iteration, (float)residual };
+}
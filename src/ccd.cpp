@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ccd.h"
+
+namespace {
+
+	const int bisectionIterations = 32;
+
+	inline float triple(glm::vec3 a, glm::vec3 b, glm::vec3 c) { return glm::dot(a, glm::cross(b, c)); }
+
+	//Times in [0, 1] when a, b and c (relative to a fourth point, moving by da, db and dc) are coplanar, in order.
+	//triple(a + t da, b + t db, c + t dc) is a cubic, split at the zeros of its derivative so every piece has one root at most
+	int coplanarTimes(glm::vec3 a, glm::vec3 da, glm::vec3 b, glm::vec3 db, glm::vec3 c, glm::vec3 dc, float times[3]) {
+
+		float k0 = triple(a, b, c);
+		float k1 = triple(da, b, c) + triple(a, db, c) + triple(a, b, dc);
+		float k2 = triple(a, db, dc) + triple(da, b, dc) + triple(da, db, c);
+		float k3 = triple(da, db, dc);
+		auto f = [&](float t) { return ((k3 * t + k2) * t + k1) * t + k0; };
+		float tolerance = 1e-6f * (fabsf(k0) + fabsf(k1) + fabsf(k2) + fabsf(k3));
+
+		//Pieces of [0, 1] between the extremes of the cubic
+		float bounds[4] = { 0, 1, 1, 1 };
+		int pieces = 1;
+		float A = 3 * k3, B = 2 * k2, C = k1;
+		if (fabsf(A) > 1e-12f) {
+			float discriminant = B * B - 4 * A * C;
+			if (discriminant > 0) {
+				float root = sqrtf(discriminant);
+				float t0 = (-B - root) / (2 * A), t1 = (-B + root) / (2 * A);
+				if (t0 > t1) { std::swap(t0, t1); }
+				if (t0 > 0 && t0 < 1) { bounds[pieces++] = t0; }
+				if (t1 > 0 && t1 < 1) { bounds[pieces++] = t1; }
+			}
+		}
+		else if (fabsf(B) > 1e-12f) {
+			float t0 = -C / B;
+			if (t0 > 0 && t0 < 1) { bounds[pieces++] = t0; }
+		}
+		bounds[pieces] = 1;
+
+		int count = 0;
+		for (int p = 0; p < pieces; p++) {
+			float low = bounds[p], high = bounds[p + 1];
+			float fLow = f(low), fHigh = f(high);
+			if (fabsf(fLow) <= tolerance) {
+				if (count == 0 || times[count - 1] < low) { times[count++] = low; }
+				continue;
+			}
+			if (fabsf(fHigh) <= tolerance) {
+				times[count++] = high;
+				continue;
+			}
+			if ((fLow < 0) == (fHigh < 0)) { continue; }
+
+			for (int iteration = 0; iteration < bisectionIterations; iteration++) {
+				float middle = 0.5f * (low + high), fMiddle = f(middle);
+				if ((fMiddle < 0) == (fLow < 0)) { low = middle; fLow = fMiddle; }
+				else { high = middle; }
+			}
+			times[count++] = high;
+		}
+		return count;
+	}
+}
+
+//Voronoi regions of the triangle (Ericson, Real-Time Collision Detection 5.1.5)
+glm::vec3 closestPointTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0 && d2 <= 0) { return a; }
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0 && d4 <= d3) { return b; }
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) { return a + d1 / (d1 - d3) * ab; }
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0 && d5 <= d6) { return c; }
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) { return a + d2 / (d2 - d6) * ac; }
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) { return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b); }
+
+	float denominator = 1 / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+//Clamped parameters of the closest points (Ericson, Real-Time Collision Detection 5.1.9)
+void closestPointsSegments(glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 d, float &s, float &u) {
+
+	const float epsilon = 1e-12f;
+	glm::vec3 d1 = b - a, d2 = d - c, r = a - c;
+	float e1 = glm::dot(d1, d1), e2 = glm::dot(d2, d2), f = glm::dot(d2, r);
+
+	if (e1 <= epsilon && e2 <= epsilon) { s = u = 0; return; }
+	if (e1 <= epsilon) {
+		s = 0;
+		u = glm::clamp(f / e2, 0.f, 1.f);
+		return;
+	}
+	float g = glm::dot(d1, r);
+	if (e2 <= epsilon) {
+		u = 0;
+		s = glm::clamp(-g / e1, 0.f, 1.f);
+		return;
+	}
+
+	float k = glm::dot(d1, d2), denominator = e1 * e2 - k * k;
+	s = denominator > epsilon ? glm::clamp((k * f - g * e2) / denominator, 0.f, 1.f) : 0.f; //Parallel segments take any point
+	u = (k * s + f) / e2;
+	if (u < 0) {
+		u = 0;
+		s = glm::clamp(-g / e1, 0.f, 1.f);
+	}
+	else if (u > 1) {
+		u = 1;
+		s = glm::clamp((k - g) / e1, 0.f, 1.f);
+	}
+}
+
+bool vertexTriangleImpact(glm::vec3 p0, glm::vec3 p1, glm::vec3 a0, glm::vec3 a1, glm::vec3 b0, glm::vec3 b1, glm::vec3 c0, glm::vec3 c1, float thickness, float &t) {
+
+	glm::vec3 dp = p1 - p0;
+	float times[3];
+	int count = coplanarTimes(a0 - p0, a1 - a0 - dp, b0 - p0, b1 - b0 - dp, c0 - p0, c1 - c0 - dp, times);
+
+	for (int k = 0; k < count; k++) {
+		glm::vec3 p = glm::mix(p0, p1, times[k]);
+		glm::vec3 q = closestPointTriangle(p, glm::mix(a0, a1, times[k]), glm::mix(b0, b1, times[k]), glm::mix(c0, c1, times[k]));
+		if (glm::dot(p - q, p - q) < thickness * thickness) {
+			t = times[k];
+			return true;
+		}
+	}
+	return false;
+}
+
+bool edgeEdgeImpact(glm::vec3 a0, glm::vec3 a1, glm::vec3 b0, glm::vec3 b1, glm::vec3 c0, glm::vec3 c1, glm::vec3 d0, glm::vec3 d1, float thickness, float &t, float &s, float &u) {
+
+	glm::vec3 da = a1 - a0;
+	float times[3];
+	int count = coplanarTimes(b0 - a0, b1 - b0 - da, c0 - a0, c1 - c0 - da, d0 - a0, d1 - d0 - da, times);
+
+	for (int k = 0; k < count; k++) {
+		glm::vec3 a = glm::mix(a0, a1, times[k]), b = glm::mix(b0, b1, times[k]);
+		glm::vec3 c = glm::mix(c0, c1, times[k]), d = glm::mix(d0, d1, times[k]);
+		closestPointsSegments(a, b, c, d, s, u);
+		glm::vec3 gap = a + s * (b - a) - (c + u * (d - c));
+		if (glm::dot(gap, gap) < thickness * thickness) {
+			t = times[k];
+			return true;
+		}
+	}
+	return false;
+}
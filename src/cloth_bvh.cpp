@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cmath>
+
+#include "cloth_bvh.h"
+
+namespace {
+
+	const int leafQuads = 4; //Grid build, leaves of up to 2x2 quads
+	const int leafTriangles = 8; //SAH build
+	const int sahBins = 12;
+	const int medianDepth = 40; //Deeper SAH splits go by the median, which bounds the depth
+	const int nodeGrain = 256; //Tree nodes per parallel task on the refit
+
+	struct Box {
+		glm::vec3 low = glm::vec3(INFINITY), high = glm::vec3(-INFINITY);
+
+		void grow(glm::vec3 l, glm::vec3 h) { low = glm::min(low, l); high = glm::max(high, h); }
+		float area() const {
+			if (low.x > high.x) { return 0; }
+			glm::vec3 d = high - low;
+			return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+	};
+
+	//Quads [row0, row1) x [column0, column1) waiting to be split
+	struct GridRange {
+		int node;
+		int row0, row1, column0, column1;
+	};
+
+	//Triangles [first, first + count) of the order waiting to be split
+	struct TriangleRange {
+		int node;
+		int first, count, depth;
+	};
+
+	//Ray against the box, slabs method. Returns the entry distance, or INFINITY
+	inline float rayBox(glm::vec3 origin, glm::vec3 invDirection, glm::vec3 low, glm::vec3 high) {
+
+		glm::vec3 t0 = (low - origin) * invDirection, t1 = (high - origin) * invDirection;
+		glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+		float enter = glm::max(glm::max(near.x, near.y), glm::max(near.z, 0.f));
+		float exit = glm::min(glm::min(far.x, far.y), far.z);
+		return enter <= exit ? enter : INFINITY;
+	}
+
+	//Moller-Trumbore, distance along the ray or INFINITY
+	inline float rayTriangle(glm::vec3 origin, glm::vec3 direction, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+
+		glm::vec3 ab = b - a, ac = c - a;
+		glm::vec3 p = glm::cross(direction, ac);
+		float determinant = glm::dot(ab, p);
+		if (fabsf(determinant) < 1e-12f) { return INFINITY; }
+		float inv = 1 / determinant;
+		glm::vec3 s = origin - a;
+		float u = glm::dot(s, p) * inv;
+		if (u < 0 || u > 1) { return INFINITY; }
+		glm::vec3 q = glm::cross(s, ab);
+		float v = glm::dot(direction, q) * inv;
+		if (v < 0 || u + v > 1) { return INFINITY; }
+		float t = glm::dot(ac, q) * inv;
+		return t >= 0 ? t : INFINITY;
+	}
+}
+
+void ClothBVH::build(const ClothGrid &grid) {
+
+	treeGrid = grid;
+	treeStats = ClothBVHStats();
+
+	//Two triangles per quad, in the same order as the self-collision uses them
+	triangleList.clear();
+	for (int row = 0; row + 1 < grid.rows; row++) {
+		for (int col = 0; col + 1 < grid.columns; col++) {
+			int a = grid.index(row, col), b = grid.index(row, col + 1), c = grid.index(row + 1, col), d = grid.index(row + 1, col + 1);
+			triangleList.push_back({ a, c, b });
+			triangleList.push_back({ b, c, d });
+		}
+	}
+
+	//Halves of the grid along its longer side. A queue keeps the nodes level by level
+	nodes.clear();
+	order.clear();
+	if (triangleList.empty()) { return; }
+	std::vector<GridRange> pending = { { 0, 0, grid.rows - 1, 0, grid.columns - 1 } };
+	nodes.push_back({});
+	for (size_t next = 0; next < pending.size(); next++) {
+		GridRange range = pending[next];
+		int rows = range.row1 - range.row0, columns = range.column1 - range.column0;
+		Node &node = nodes[range.node];
+
+		if (rows * columns <= leafQuads) {
+			node.first = (int)order.size();
+			node.count = 2 * rows * columns;
+			for (int row = range.row0; row < range.row1; row++) {
+				for (int col = range.column0; col < range.column1; col++) {
+					int quad = row * (grid.columns - 1) + col;
+					order.push_back(2 * quad);
+					order.push_back(2 * quad + 1);
+				}
+			}
+			continue;
+		}
+
+		int left = (int)nodes.size();
+		node.first = left;
+		node.count = 0;
+		nodes.push_back({});
+		nodes.push_back({});
+		if (rows >= columns) {
+			int middle = range.row0 + rows / 2;
+			pending.push_back({ left, range.row0, middle, range.column0, range.column1 });
+			pending.push_back({ left + 1, middle, range.row1, range.column0, range.column1 });
+		}
+		else {
+			int middle = range.column0 + columns / 2;
+			pending.push_back({ left, range.row0, range.row1, range.column0, middle });
+			pending.push_back({ left + 1, range.row0, range.row1, middle, range.column1 });
+		}
+	}
+	finishBuild();
+}
+
+void ClothBVH::finishBuild() {
+
+	//Nodes were made by a queue, so the depth never goes down along the array
+	std::vector<int> depth(nodes.size(), 0);
+	levelStart.assign(1, 0);
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (i > 0 && depth[i] != depth[i - 1]) { levelStart.push_back((int)i); }
+		if (nodes[i].count == 0) { depth[nodes[i].first] = depth[nodes[i].first + 1] = depth[i] + 1; }
+	}
+	levelStart.push_back((int)nodes.size());
+
+	//Corners of the triangles of every leaf without repeats, 9 for a grid leaf of 2x2 quads instead of 24
+	leafNodeStart.assign(nodes.size() + 1, 0);
+	leafNodes.clear();
+	for (size_t i = 0; i < nodes.size(); i++) {
+		size_t first = leafNodes.size();
+		for (int k = nodes[i].first; k < nodes[i].first + nodes[i].count; k++) {
+			for (int c = 0; c < 3; c++) { leafNodes.push_back(triangleList[order[k]][c]); }
+		}
+		std::sort(leafNodes.begin() + first, leafNodes.end());
+		leafNodes.erase(std::unique(leafNodes.begin() + first, leafNodes.end()), leafNodes.end());
+		leafNodeStart[i + 1] = (int)leafNodes.size();
+	}
+
+	treeStats.nodes = (int)nodes.size();
+	treeStats.depth = (int)levelStart.size() - 1;
+	costPending = true;
+}
+
+void ClothBVH::buildSAH(const ParticleState &state, bool swept) {
+
+	std::vector<glm::vec3> bounds(2 * triangleList.size()), centroid(triangleList.size());
+	for (size_t t = 0; t < triangleList.size(); t++) {
+		triangleBounds(state, swept, (int)t, bounds[2 * t], bounds[2 * t + 1]);
+		centroid[t] = 0.5f * (bounds[2 * t] + bounds[2 * t + 1]);
+	}
+
+	nodes.assign(1, Node());
+	std::vector<TriangleRange> pending = { { 0, 0, (int)order.size(), 0 } };
+	for (size_t next = 0; next < pending.size(); next++) {
+		TriangleRange range = pending[next];
+		int *first = order.data() + range.first, *last = first + range.count;
+
+		if (range.count <= leafTriangles) {
+			nodes[range.node].first = range.first;
+			nodes[range.node].count = range.count;
+			continue;
+		}
+
+		Box centers;
+		for (int *t = first; t < last; t++) { centers.grow(centroid[*t], centroid[*t]); }
+		glm::vec3 extent = centers.high - centers.low;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+		//Binned SAH, the cost of a split is the area times the triangles of each side
+		int split = range.count / 2;
+		if (range.depth < medianDepth && extent[axis] > 0) {
+			Box bins[sahBins];
+			int counts[sahBins] = {};
+			float scale = sahBins / extent[axis];
+			auto binOf = [&](int t) { return glm::min(sahBins - 1, (int)((centroid[t][axis] - centers.low[axis]) * scale)); };
+			for (int *t = first; t < last; t++) {
+				int bin = binOf(*t);
+				counts[bin]++;
+				bins[bin].grow(bounds[2 * *t], bounds[2 * *t + 1]);
+			}
+
+			float rightCost[sahBins];
+			Box right;
+			int rightCount = 0;
+			for (int bin = sahBins - 1; bin > 0; bin--) {
+				right.grow(bins[bin].low, bins[bin].high);
+				rightCount += counts[bin];
+				rightCost[bin] = right.area() * rightCount;
+			}
+			Box left;
+			int leftCount = 0, bestBin = 0;
+			float bestCost = INFINITY;
+			for (int bin = 0; bin + 1 < sahBins; bin++) {
+				left.grow(bins[bin].low, bins[bin].high);
+				leftCount += counts[bin];
+				float cost = left.area() * leftCount + rightCost[bin + 1];
+				if (leftCount > 0 && leftCount < range.count && cost < bestCost) { bestCost = cost; bestBin = bin + 1; }
+			}
+			if (bestBin > 0) { split = (int)(std::partition(first, last, [&](int t) { return binOf(t) < bestBin; }) - first); }
+			else { std::nth_element(first, first + split, last, [&](int a, int b) { return centroid[a][axis] < centroid[b][axis]; }); }
+		}
+		else {
+			std::nth_element(first, first + split, last, [&](int a, int b) { return centroid[a][axis] < centroid[b][axis]; });
+		}
+
+		int left = (int)nodes.size();
+		nodes[range.node].first = left;
+		nodes[range.node].count = 0;
+		nodes.push_back({});
+		nodes.push_back({});
+		pending.push_back({ left, range.first, split, range.depth + 1 });
+		pending.push_back({ left + 1, range.first + split, range.count - split, range.depth + 1 });
+	}
+	finishBuild();
+	treeStats.rebuilds++;
+}
+
+void ClothBVH::triangleBounds(const ParticleState &state, bool swept, int t, glm::vec3 &low, glm::vec3 &high) const {
+
+	low = high = state.pos.get(triangleList[t].x);
+	for (int k = 0; k < 3; k++) {
+		glm::vec3 p = state.pos.get(triangleList[t][k]);
+		low = glm::min(low, p);
+		high = glm::max(high, p);
+		if (swept) {
+			glm::vec3 last = state.last.get(triangleList[t][k]);
+			low = glm::min(low, last);
+			high = glm::max(high, last);
+		}
+	}
+}
+
+void ClothBVH::refit(const ParticleState &state, bool swept, ThreadPool &pool) {
+
+	if (nodes.empty()) { return; }
+	nodeArea.resize(nodes.size());
+	for (int pass = 0; pass < 2; pass++) {
+		//Deepest level first, a node only reads the boxes of its children or the nodes of its triangles
+		for (int level = (int)levelStart.size() - 2; level >= 0; level--) {
+			pool.parallelFor(levelStart[level + 1] - levelStart[level], nodeGrain, [&](int begin, int end) {
+				for (int i = levelStart[level] + begin; i < levelStart[level] + end; i++) {
+					Node &node = nodes[i];
+					Box box;
+					if (node.count > 0) {
+						for (int k = leafNodeStart[i]; k < leafNodeStart[i + 1]; k++) {
+							glm::vec3 p = state.pos.get(leafNodes[k]);
+							box.grow(p, p);
+						}
+						if (swept) {
+							for (int k = leafNodeStart[i]; k < leafNodeStart[i + 1]; k++) {
+								glm::vec3 last = state.last.get(leafNodes[k]);
+								box.grow(last, last);
+							}
+						}
+						nodeArea[i] = 0;
+					}
+					else {
+						box.grow(nodes[node.first].low, nodes[node.first].high);
+						box.grow(nodes[node.first + 1].low, nodes[node.first + 1].high);
+						nodeArea[i] = box.area();
+					}
+					node.low = box.low;
+					node.high = box.high;
+				}
+			});
+		}
+
+		//Summed in order, the same with any number of threads
+		float internalArea = 0;
+		for (float area : nodeArea) { internalArea += area; }
+		treeStats.cost = nodeArea[0] > 0 ? internalArea / nodeArea[0] : 0;
+		if (costPending) {
+			treeStats.buildCost = treeStats.cost;
+			costPending = false;
+		}
+
+		//Rebuilt at most once a step, the new tree is refitted on the second pass
+		if (pass > 0 || treeStats.cost <= rebuildRatio * treeStats.buildCost) { break; }
+		buildSAH(state, swept);
+		nodeArea.resize(nodes.size());
+	}
+}
+
+bool ClothBVH::raycast(const ParticleState &state, glm::vec3 origin, glm::vec3 direction, int &triangle, float &t) const {
+
+	if (nodes.empty()) { return false; }
+	glm::vec3 invDirection = 1.f / direction;
+	float closest = INFINITY;
+	int stack[maxDepth + 1];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node &node = nodes[stack[--top]];
+		if (rayBox(origin, invDirection, node.low, node.high) >= closest) { continue; }
+		if (node.count > 0) {
+			for (int k = node.first; k < node.first + node.count; k++) {
+				const glm::ivec3 &tri = triangleList[order[k]];
+				float hit = rayTriangle(origin, direction, state.pos.get(tri.x), state.pos.get(tri.y), state.pos.get(tri.z));
+				if (hit < closest) {
+					closest = hit;
+					triangle = order[k];
+				}
+			}
+			continue;
+		}
+		stack[top++] = node.first + 1;
+		stack[top++] = node.first;
+	}
+	t = closest;
+	return closest < INFINITY;
+}
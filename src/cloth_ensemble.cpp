@@ -0,0 +1,112 @@
+#include <algorithm>
+
+#include "cloth_ensemble.h"
+#include "profiler.h"
+
+void ClothEnsemble::allocate(ClothGrid grid, const std::vector<EnsembleMaterial> &instances) {
+
+	//Lanes are whole vectors of the widest path, 16 is two AVX2 vectors
+	lanes = glm::clamp(lanes / simdWidth * simdWidth, simdWidth, maxEnsembleLanes);
+	mesh.params.integrator = IntegratorType::SymplecticEuler;
+	mesh.params.strainOrdering = StrainOrdering::GaussSeidel;
+	mesh.allocate(grid);
+	materials = instances;
+
+	groups.clear();
+	for (size_t first = 0; first < materials.size(); first += lanes) {
+		groups.emplace_back(new EnsembleGroup());
+		EnsembleGroup &group = *groups.back();
+		group.instances = (int)std::min(materials.size() - first, (size_t)lanes);
+		group.nodes.allocate(grid.totalVertex() * lanes);
+		float *block = group.parameters.reserve(4, lanes);
+		group.Ke = block;
+		group.Kd = block + SoAArena::stride(lanes);
+		group.elasticity = block + 2 * SoAArena::stride(lanes);
+		group.maxScale = block + 3 * SoAArena::stride(lanes);
+		for (int l = 0; l < lanes; l++) {
+			const EnsembleMaterial &material = materials[first + std::min(l, group.instances - 1)];
+			group.Ke[l] = material.Ke;
+			group.Kd[l] = material.Kd;
+			group.elasticity[l] = material.elasticity;
+			group.maxScale[l] = 1 + material.maxElongation / 100.f;
+		}
+	}
+	reset();
+}
+
+void ClothEnsemble::release() {
+
+	groups.clear();
+	materials.clear();
+	mesh.release();
+}
+
+void ClothEnsemble::reset() {
+
+	//Every lane starts at the rest state of the mesh
+	mesh.reset();
+	const ParticleState &rest = mesh.nodes;
+	for (std::unique_ptr<EnsembleGroup> &group : groups) {
+		ParticleState &nodes = group->nodes;
+		for (int i = 0; i < rest.count; i++) {
+			for (int l = 0; l < lanes; l++) {
+				int slot = i * lanes + l;
+				nodes.pos.set(slot, rest.pos.get(i));
+				nodes.last.set(slot, rest.pos.get(i));
+				nodes.vel.set(slot, { 0, 0, 0 });
+				nodes.force.set(slot, { 0, 0, 0 });
+				nodes.invMass[slot] = rest.invMass[i];
+			}
+		}
+	}
+}
+
+void ClothEnsemble::step(float dt) {
+
+	PROFILE_SCOPE("Ensemble step");
+	const ClothParams &params = mesh.params;
+	mesh.applyParameters();
+	mesh.pool.setThreadCount(params.threads);
+	KernelPath path = mesh.kernelPath();
+	const std::vector<Spring> &springs = mesh.springs;
+	const std::vector<Collider> &colliders = mesh.colliders;
+
+	//The springs go in the order of the colored list, so every node adds its forces as a ClothSimulation would
+	mesh.pool.parallelFor((int)groups.size(), 1, [&](int begin, int end) {
+		for (int g = begin; g < end; g++) {
+			EnsembleGroup &group = *groups[g];
+			ParticleState &nodes = group.nodes;
+			nodes.clearForces();
+			accumulateEnsembleForces(path, nodes.pos, nodes.vel, nodes.force, springs.data(), (int)springs.size(), group.Ke, group.Kd, lanes);
+			integrateSymplecticEuler(path, nodes, dt, glm::vec3(0, -9.81f, 0));
+			limitEnsembleStrain(path, nodes.pos, nodes.invMass, springs.data(), (int)springs.size(), group.maxScale, lanes, params.strainIterations, params.strainTolerance);
+			collideEnsembleNodes(path, nodes, colliders.data(), (int)colliders.size(), group.elasticity, lanes, dt, params.continuousCollisions);
+		}
+	});
+}
+
+glm::vec3 ClothEnsemble::position(int instance, int node) const {
+
+	return groups[instance / lanes]->nodes.pos.get(node * lanes + instance % lanes);
+}
+
+EnsembleMetrics ClothEnsemble::metrics(int instance) const {
+
+	const EnsembleGroup &group = *groups[instance / lanes];
+	const EnsembleMaterial &material = materials[instance];
+	const ParticleState &nodes = group.nodes;
+	int lane = instance % lanes;
+	EnsembleMetrics metrics = { 0, 0, 0 };
+
+	for (int i = 0; i < mesh.nodes.count; i++) {
+		glm::vec3 p = nodes.pos.get(i * lanes + lane), v = nodes.vel.get(i * lanes + lane);
+		metrics.sag = glm::max(metrics.sag, mesh.params.height - p.y);
+		if (nodes.invMass[i * lanes + lane] > 0) { metrics.energy += 0.5f * glm::dot(v, v) + 9.81f * p.y; } //Unit mass
+	}
+	for (const Spring &spring : mesh.springs) {
+		float length = glm::distance(nodes.pos.get(spring.i * lanes + lane), nodes.pos.get(spring.j * lanes + lane));
+		metrics.energy += 0.5f * material.Ke * (length - spring.restLength) * (length - spring.restLength);
+		if (spring.kind != SpringKind::Bending) { metrics.maxStrain = glm::max(metrics.maxStrain, length / spring.restLength - 1); }
+	}
+	return metrics;
+}
@@ -0,0 +1,21 @@
+#include <cstdio>
+#include <string>
+
+#include "cloth_grid.h"
+
+bool parseGridList(const char *list, std::vector<ClothGrid> &grids) {
+
+	grids.clear();
+	std::string text = list;
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t end = text.find(',', start);
+		if (end == std::string::npos) { end = text.size(); }
+		ClothGrid grid;
+		if (sscanf(text.substr(start, end - start).c_str(), "%dx%d", &grid.rows, &grid.columns) != 2) { return false; }
+		if (grid.rows < minClothSide || grid.columns < minClothSide || grid.rows > maxClothSide || grid.columns > maxClothSide) { return false; }
+		grids.push_back(grid);
+		start = end + 1;
+	}
+	return !grids.empty();
+}
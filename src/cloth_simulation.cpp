@@ -0,0 +1,313 @@
+#include <chrono>
+
+#include "cloth_simulation.h"
+#include "profiler.h"
+
+namespace {
+
+	const int springGrain = 2048; //Springs per parallel task
+	const int collisionGrain = 4096; //Nodes per parallel task, multiple of simdWidth
+	const int gridBandNodes = 4096; //Nodes of the bands of rows of the grid kernels
+
+	float elapsedTime(std::chrono::high_resolution_clock::time_point start) {
+
+		//Milliseconds since "start"
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+void ClothSimulation::allocate(ClothGrid size) {
+
+	grid = size;
+	nodes.allocate(grid.totalVertex());
+	reset();
+}
+
+void ClothSimulation::release() {
+
+	integrator.reset();
+	nodes.release();
+	precise.release();
+	statePrecision = Precision::Float;
+}
+
+glm::vec3 ClothSimulation::initialPosition(int row, int column) const {
+
+	//Position of a node on the flat mesh with an "L" separation
+	float L = params.L;
+	return { L * column - (L*grid.columns / 2) + L / 2, params.height, L * row - (L*grid.rows / 2) + L / 2 };
+}
+
+bool ClothSimulation::isPinned(int i) const {
+
+	//Top left and top right nodes are always fixed
+	return i == 0 || i == grid.columns - 1;
+}
+
+void ClothSimulation::reset() {
+
+	//Resets to the beggining all the positions, forces and velocites of the mesh
+	for (int row = 0; row < grid.rows; row++) {
+		for (int column = 0; column < grid.columns; column++) {
+			int i = grid.index(row, column);
+			nodes.pos.set(i, initialPosition(row, column));
+			nodes.last.set(i, nodes.pos.get(i));
+			nodes.vel.set(i, { 0,0,0 });
+			nodes.force.set(i, { 0,0,0 });
+			nodes.invMass[i] = isPinned(i) ? 0.f : 1.f;
+		}
+	}
+
+	buildSprings(springs, grid.rows, grid.columns, params.L);
+	colorSprings(springs, grid.totalVertex(), springColors);
+	springsL = params.L;
+	bvh.build(grid);
+	bvhMargin = -1;
+
+	time = 0;
+	for (const ColliderAnimation &animation : animations) { animateCollider(colliders[animation.collider], animation, time); }
+	statePrecision = Precision::Float;
+}
+
+KernelPath ClothSimulation::kernelPath() const {
+
+	return params.useSimd ? bestKernelPath() : KernelPath::Scalar;
+}
+
+Precision ClothSimulation::activePrecision() const {
+
+	bool velocityStep = params.integrator == IntegratorType::SymplecticEuler || params.integrator == IntegratorType::ImplicitEuler;
+	if (params.precision == Precision::Double && params.integrator == IntegratorType::SymplecticEuler) { return Precision::Double; }
+	if (params.precision != Precision::Float && velocityStep) { return Precision::Mixed; }
+	return Precision::Float;
+}
+
+int ClothSimulation::pickNode(glm::vec3 origin, glm::vec3 direction) {
+
+	//Boxes of the positions only, the next collision stage refits again with the motion of its step
+	bvh.refit(nodes, false, pool);
+	bvhMargin = -1;
+	int triangle;
+	float t;
+	if (!bvh.raycast(nodes, origin, direction, triangle, t)) { return -1; }
+	glm::vec3 hit = origin + t * direction;
+	const glm::ivec3 &corners = bvh.triangles()[triangle];
+	int closest = corners.x;
+	for (int k = 1; k < 3; k++) {
+		if (glm::distance(nodes.pos.get(corners[k]), hit) < glm::distance(nodes.pos.get(closest), hit)) { closest = corners[k]; }
+	}
+	return closest;
+}
+
+void ClothSimulation::calculateAllForces(const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force) {
+
+	PROFILE_SCOPE("Forces"); //Every evaluation, also the ones of the integrators
+	clearSoA(force, nodes.capacity);
+	KernelPath path = kernelPath();
+	if (params.gridKernels) {
+		gridForces(gridForceKernel(path, grid), pos, vel, force);
+		return;
+	}
+
+	//One pass over the spring list, every spring is evaluated once and applied to both of its nodes.
+	//Springs of a color don't share nodes, so its batches are split between threads without locks and
+	//every node always gets its forces in the same order, whatever the number of threads
+	for (size_t color = 0; color + 1 < springColors.size(); color++) {
+		const Spring *colorSprings = springs.data() + springColors[color];
+		pool.parallelFor(springColors[color + 1] - springColors[color], springGrain, [&](int begin, int end) {
+			accumulateSpringForces(path, pos, vel, force, colorSprings + begin, end - begin, (float)params.Ke, params.Kd);
+		});
+	}
+}
+
+void ClothSimulation::calculatePreciseForces() {
+
+	PROFILE_SCOPE("Forces");
+	clearSoA(precise.force, precise.capacity);
+	if (params.gridKernels) {
+		gridForces(gridForceKernelDouble(kernelPath(), grid), precise.pos, precise.vel, precise.force);
+		return;
+	}
+
+	//Same coloring as the float spring list
+	for (size_t color = 0; color + 1 < springColors.size(); color++) {
+		const Spring *colorSprings = springs.data() + springColors[color];
+		pool.parallelFor(springColors[color + 1] - springColors[color], springGrain, [&](int begin, int end) {
+			accumulateSpringForcesDouble(precise.pos, precise.vel, precise.force, colorSprings + begin, end - begin, (float)params.Ke, params.Kd);
+		});
+	}
+}
+
+template <class Real>
+void ClothSimulation::gridForces(BasicGridForceKernel<Real> kernel, const BasicSoAVec3<Real> &pos, const BasicSoAVec3<Real> &vel, BasicSoAVec3<Real> &force) {
+
+	//Stencil over the rows of the grid. A band writes up to two rows into the next one, so the even bands run
+	//at once and then the odd ones, and every node gets its forces in the same order whatever the number of threads
+	GridSpringParams springParams = { springsL, sqrtf(springsL*springsL + springsL*springsL), springsL * 2, (float)params.Ke, params.Kd };
+	int bandRows = glm::max(2, gridBandNodes / glm::max(1, grid.columns));
+	int bands = (grid.rows + bandRows - 1) / bandRows;
+	for (int parity = 0; parity < 2; parity++) {
+		pool.parallelFor((bands - parity + 1) / 2, 1, [&](int begin, int end) {
+			for (int band = 2 * begin + parity; band < 2 * end + parity; band += 2) {
+				kernel(pos, vel, force, grid, band * bandRows, glm::min(grid.rows, (band + 1) * bandRows), springParams);
+			}
+		});
+	}
+}
+
+float ClothSimulation::compareKernels() {
+
+	//Evaluates the forces of the current state with the SIMD and the scalar kernels and returns the max difference
+	nodes.clearForces();
+	accumulateSpringForces(bestKernelPath(), nodes.pos, nodes.vel, nodes.force, springs.data(), (int)springs.size(), (float)params.Ke, params.Kd);
+	std::vector<glm::vec3> simdForces(nodes.count);
+	for (int i = 0; i < nodes.count; i++) { simdForces[i] = nodes.force.get(i); }
+
+	nodes.clearForces();
+	accumulateSpringForces(KernelPath::Scalar, nodes.pos, nodes.vel, nodes.force, springs.data(), (int)springs.size(), (float)params.Ke, params.Kd);
+	float difference = 0;
+	for (int i = 0; i < nodes.count; i++) { difference = glm::max(difference, glm::length(simdForces[i] - nodes.force.get(i))); }
+
+	nodes.clearForces();
+	return difference;
+}
+
+void ClothSimulation::checkElongation() {
+
+	PROFILE_SCOPE("Strain limiting");
+	//Structural and shear springs can't be longer than the max elongation (%)
+	StrainLimitParams strain = { params.maxElongation / 100.f, params.strainTolerance, params.strainIterations, params.strainOrdering };
+	if (statePrecision == Precision::Double) {
+		strainSweeps = limitStrain(precise.pos, nodes.invMass, nodes.count, springs, springColors, strain, preciseStrainScratch, pool);
+		precise.round(nodes, false);
+		return;
+	}
+	strainSweeps = limitStrain(nodes.pos, nodes.invMass, nodes.count, springs, springColors, strain, strainScratch, pool);
+}
+
+void ClothSimulation::refitBVH() {
+
+	bvh.refit(nodes, params.continuousCollisions, pool);
+	bvhMargin = 0;
+}
+
+void ClothSimulation::calculateSelfCollisions() {
+
+	PROFILE_SCOPE("Self-collisions");
+	//Cells of two rest distances hold a triangle in one or two cells per axis, smaller cells spend more on the hash than they save on tests
+	float cellSize = glm::max(2 * params.L, 4 * params.selfThickness);
+	SelfCollisionParams self = { params.selfThickness, cellSize, params.continuousCollisions, params.selfBroadphase };
+	if (bvhMargin != 0) { refitBVH(); }
+	selfCollision.solve(nodes, springs, bvh, self, pool);
+	bvhMargin = selfCollision.stats().maxCorrection;
+}
+
+void ClothSimulation::calculateAllCollisions(float dt) {
+
+	PROFILE_SCOPE("Collisions");
+	if (colliders.empty()) { return; }
+	KernelPath path = kernelPath();
+
+	//Without a refit on the step every block of nodes goes through all the colliders, a refit would cost more than the pass
+	if (bvhMargin < 0) {
+		int blocks = nodes.capacity / simdWidth;
+		pool.parallelFor(blocks, collisionGrain / simdWidth, [&](int begin, int end) {
+			collideNodes(path, nodes, begin * simdWidth, end * simdWidth, colliders.data(), (int)colliders.size(), dt, params.continuousCollisions);
+		});
+		return;
+	}
+
+	//Only the blocks with a triangle in a BVH leaf near an enabled collider, with the boxes grown by what the self-collision
+	//moved the nodes after the refit. The other blocks can't touch any collider, so the result is the same
+	const std::vector<glm::ivec3> &triangles = bvh.triangles();
+	collisionBlocks.assign(nodes.capacity / simdWidth, 0);
+	for (const Collider &collider : colliders) {
+		if (!collider.enabled) { continue; }
+		glm::vec3 shift = params.continuousCollisions ? collider.velocity * dt : glm::vec3(0, 0, 0);
+		auto touches = [&](glm::vec3 low, glm::vec3 high) { return colliderMayTouch(collider, low - bvhMargin, high + bvhMargin, shift); };
+		bvh.query(touches, [&](int t) {
+			for (int k = 0; k < 3; k++) { collisionBlocks[triangles[t][k] / simdWidth] = 1; }
+		});
+	}
+	activeBlocks.clear();
+	for (int b = 0; b < (int)collisionBlocks.size(); b++) {
+		if (collisionBlocks[b]) { activeBlocks.push_back(b); }
+	}
+
+	//Consecutive blocks go together to the kernel
+	pool.parallelFor((int)activeBlocks.size(), collisionGrain / simdWidth, [&](int begin, int end) {
+		for (int k = begin; k < end;) {
+			int first = activeBlocks[k++], last = first + 1;
+			while (k < end && activeBlocks[k] == last) { k++; last++; }
+			collideNodes(path, nodes, first * simdWidth, last * simdWidth, colliders.data(), (int)colliders.size(), dt, params.continuousCollisions);
+		}
+	});
+	bvhMargin = -1;
+}
+
+void ClothSimulation::applyParameters() {
+
+	//The state is kept, the springs pull the nodes to the new rest lengths
+	if (params.L != springsL) {
+		setRestLengths(springs, params.L);
+		springsL = params.L;
+	}
+}
+
+void ClothSimulation::step(float dt) {
+
+	PROFILE_SCOPE("Step");
+	applyParameters();
+
+	//Top left and top right always the same positions
+	nodes.pos.set(0, initialPosition(0, 0));
+	nodes.pos.set(grid.columns - 1, initialPosition(0, grid.columns - 1));
+
+	pool.setThreadCount(params.threads);
+
+	time += dt;
+	for (const ColliderAnimation &animation : animations) { animateCollider(colliders[animation.collider], animation, time); }
+
+	if (!integrator || integrator->type() != params.integrator) { integrator = createIntegrator(params.integrator); }
+
+	//The double state starts from the float one, and then takes what changed on the float one between steps (like a dragged node)
+	Precision precision = activePrecision();
+	if (precision != Precision::Float) {
+		if (statePrecision == Precision::Float || precise.capacity != nodes.capacity) { precise.load(nodes); }
+		else { precise.sync(nodes, precision == Precision::Double); }
+	}
+	statePrecision = precision;
+	const glm::vec3 gravity(0, -9.81f, 0);
+
+	auto stageStart = std::chrono::high_resolution_clock::now();
+	if (precision == Precision::Double) { calculatePreciseForces(); }
+	else if (integrator->usesForces()) { calculateAllForces(nodes.pos, nodes.vel, nodes.force); } //Calculate forces and store them on the node arrays
+	timings.forces = elapsedTime(stageStart);
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	ForceFunction forces = [this](const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force) { calculateAllForces(pos, vel, force); };
+	IntegrationContext context = { forces, &springs, &springColors, (float)params.Ke, params.Kd, &pool, grid, params.solverTolerance, params.solverIterations, params.solverWarmStart, params.solverSubsteps, params.constraintIterations };
+	{
+		PROFILE_SCOPE("Integration"); //With the force evaluations of the integrator
+		if (precision == Precision::Double) { precise.integrateSymplecticEuler(nodes, dt, gravity); }
+		else {
+			integrator->step(kernelPath(), nodes, context, dt, gravity); //Velocities with gravity and positions. Fixed nodes don't move
+			if (precision == Precision::Mixed) { precise.advancePositions(nodes, dt); }
+		}
+	}
+	timings.integration = elapsedTime(stageStart);
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	checkElongation(); //Once per step
+	timings.strain = elapsedTime(stageStart);
+	bvhMargin = -1;
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	if (params.selfCollision) { calculateSelfCollisions(); }
+	timings.selfCollision = elapsedTime(stageStart);
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	calculateAllCollisions(dt);
+	if (precision != Precision::Float) { precise.sync(nodes, precision == Precision::Double); }
+	timings.collisions = elapsedTime(stageStart);
+}
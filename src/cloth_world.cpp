@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <chrono>
+
+#include "cloth_world.h"
+#include "profiler.h"
+
+ClothInstance &ClothWorld::add(ClothGrid grid, const ClothParams &params) {
+
+	instances.emplace_back(new ClothInstance());
+	ClothSimulation &simulation = instances.back()->simulation;
+	simulation.params = params;
+	simulation.params.threads = 1;
+	simulation.allocate(grid);
+	return *instances.back();
+}
+
+void ClothWorld::remove(int index) {
+
+	instances[index]->simulation.release();
+	instances.erase(instances.begin() + index);
+}
+
+void ClothWorld::clear() {
+
+	for (std::unique_ptr<ClothInstance> &instance : instances) { instance->simulation.release(); }
+	instances.clear();
+}
+
+void ClothWorld::step(float dt) {
+
+	PROFILE_SCOPE("World step");
+	pool.setThreadCount(threads);
+
+	//Most expensive first by the last step, or by the nodes before the first one
+	std::vector<int> order(instances.size());
+	for (size_t i = 0; i < order.size(); i++) { order[i] = (int)i; }
+	std::sort(order.begin(), order.end(), [this](int a, int b) {
+		const ClothInstance &first = *instances[a], &second = *instances[b];
+		if (first.stepTime != second.stepTime) { return first.stepTime > second.stepTime; }
+		return first.simulation.grid.totalVertex() > second.simulation.grid.totalVertex();
+	});
+
+	pool.run(order, [this, dt](int i) {
+		TRACE_SCOPE("Cloth instance");
+		ClothInstance &instance = *instances[i];
+		auto start = std::chrono::high_resolution_clock::now();
+		instance.simulation.step(dt);
+		instance.stepTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	});
+}
+
+int ClothWorld::totalNodes() const {
+
+	int nodes = 0;
+	for (const std::unique_ptr<ClothInstance> &instance : instances) { nodes += instance->simulation.grid.totalVertex(); }
+	return nodes;
+}
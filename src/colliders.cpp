@@ -0,0 +1,102 @@
+#include <cmath>
+
+#include "colliders.h"
+
+Collider planeCollider(glm::vec3 normal, float offset, float elasticity, float friction) {
+
+	Collider collider = {};
+	collider.type = ColliderType::Plane;
+	collider.normal = glm::normalize(normal);
+	collider.offset = offset / glm::length(normal);
+	collider.elasticity = elasticity;
+	collider.friction = friction;
+	collider.enabled = true;
+	return collider;
+}
+
+Collider boxCollider(glm::vec3 min, glm::vec3 max, float elasticity, float friction) {
+
+	Collider collider = {};
+	collider.type = ColliderType::Box;
+	collider.min = glm::min(min, max);
+	collider.max = glm::max(min, max);
+	collider.elasticity = elasticity;
+	collider.friction = friction;
+	collider.enabled = true;
+	return collider;
+}
+
+Collider sphereCollider(glm::vec3 center, float radius, float elasticity, float friction) {
+
+	Collider collider = {};
+	collider.type = ColliderType::Sphere;
+	collider.center = center;
+	collider.radius = radius;
+	collider.elasticity = elasticity;
+	collider.friction = friction;
+	collider.enabled = true;
+	return collider;
+}
+
+Collider capsuleCollider(glm::vec3 a, glm::vec3 b, float radius, float elasticity, float friction) {
+
+	Collider collider = {};
+	collider.type = ColliderType::Capsule;
+	collider.center = a;
+	collider.end = b;
+	collider.radius = radius;
+	collider.elasticity = elasticity;
+	collider.friction = friction;
+	collider.enabled = true;
+	return collider;
+}
+
+bool colliderMayTouch(const Collider &collider, glm::vec3 low, glm::vec3 high, glm::vec3 shift) {
+
+	low -= glm::abs(shift);
+	high += glm::abs(shift);
+	switch (collider.type) {
+	case ColliderType::Plane: { //Corner of the box furthest into the plane
+		glm::vec3 corner = { collider.normal.x > 0 ? low.x : high.x, collider.normal.y > 0 ? low.y : high.y, collider.normal.z > 0 ? low.z : high.z };
+		return glm::dot(collider.normal, corner) + collider.offset < 0;
+	}
+	case ColliderType::Box:
+		return glm::any(glm::lessThan(low, collider.min)) || glm::any(glm::greaterThan(high, collider.max));
+	case ColliderType::Sphere: {
+		glm::vec3 closest = glm::clamp(collider.center, low, high);
+		return glm::dot(closest - collider.center, closest - collider.center) < collider.radius * collider.radius;
+	}
+	case ColliderType::Capsule: {
+		glm::vec3 shapeLow = glm::min(collider.center, collider.end) - collider.radius;
+		glm::vec3 shapeHigh = glm::max(collider.center, collider.end) + collider.radius;
+		return !glm::any(glm::lessThan(high, shapeLow)) && !glm::any(glm::greaterThan(low, shapeHigh));
+	}
+	default:
+		return true;
+	}
+}
+
+const char *colliderTypeName(ColliderType type) {
+	switch (type) {
+	case ColliderType::Plane: return "Plane";
+	case ColliderType::Box: return "Box";
+	case ColliderType::Sphere: return "Sphere";
+	case ColliderType::Capsule: return "Capsule";
+	default: return "";
+	}
+}
+
+void animateCollider(Collider &collider, const ColliderAnimation &animation, float t) {
+
+	const float omega = 2 * 3.14159265f * animation.frequency;
+	glm::vec3 offset = animation.amplitude * sinf(omega * t);
+	collider.center = animation.center + offset;
+	collider.end = animation.end + offset;
+	collider.velocity = animation.amplitude * omega * cosf(omega * t);
+}
+
+std::vector<Collider> defaultColliders() {
+
+	//Ground at y = 0, roof at y = 10 and walls at x, z = +-5
+	return { boxCollider({ -5, 0, -5 }, { 5, 10, 5 }, 0.8f, 0.f) };
+}
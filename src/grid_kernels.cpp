@@ -0,0 +1,126 @@
+#include "grid_kernels.h"
+#include "simd_lanes.h"
+
+namespace {
+
+	//Springs from the nodes [i, i + width) to the nodes "offset" ahead, with the force formula of springForces
+	template <class Lanes>
+	inline void springBatch(const BasicSoAVec3<typename Lanes::T> &pos, const BasicSoAVec3<typename Lanes::T> &vel, BasicSoAVec3<typename Lanes::T> &force, int i, int offset, float rest, float Ke, float Kd) {
+
+		typedef typename Lanes::V V;
+		const V one = Lanes::set1(1.f), zero = Lanes::set1(0.f);
+		int j = i + offset;
+
+		V dx = Lanes::sub(Lanes::loadu(pos.x + i), Lanes::loadu(pos.x + j));
+		V dy = Lanes::sub(Lanes::loadu(pos.y + i), Lanes::loadu(pos.y + j));
+		V dz = Lanes::sub(Lanes::loadu(pos.z + i), Lanes::loadu(pos.z + j));
+		V distance = Lanes::sqrt(Lanes::add(Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy)), Lanes::mul(dz, dz)));
+		V inv = Lanes::div(one, distance);
+		V nx = Lanes::mul(dx, inv), ny = Lanes::mul(dy, inv), nz = Lanes::mul(dz, inv);
+
+		V dvx = Lanes::sub(Lanes::loadu(vel.x + i), Lanes::loadu(vel.x + j));
+		V dvy = Lanes::sub(Lanes::loadu(vel.y + i), Lanes::loadu(vel.y + j));
+		V dvz = Lanes::sub(Lanes::loadu(vel.z + i), Lanes::loadu(vel.z + j));
+		V damping = Lanes::mul(Lanes::set1(Kd), Lanes::add(Lanes::add(Lanes::mul(dvx, nx), Lanes::mul(dvy, ny)), Lanes::mul(dvz, nz)));
+
+		V calc = Lanes::sub(zero, Lanes::add(Lanes::mul(Lanes::set1(Ke), Lanes::sub(distance, Lanes::set1(rest))), damping));
+		V fx = Lanes::mul(calc, nx), fy = Lanes::mul(calc, ny), fz = Lanes::mul(calc, nz);
+
+		//The end nodes can overlap the start ones (offsets 1 and 2), the second update reads the first
+		Lanes::storeu(force.x + i, Lanes::add(Lanes::loadu(force.x + i), fx));
+		Lanes::storeu(force.y + i, Lanes::add(Lanes::loadu(force.y + i), fy));
+		Lanes::storeu(force.z + i, Lanes::add(Lanes::loadu(force.z + i), fz));
+		Lanes::storeu(force.x + j, Lanes::sub(Lanes::loadu(force.x + j), fx));
+		Lanes::storeu(force.y + j, Lanes::sub(Lanes::loadu(force.y + j), fy));
+		Lanes::storeu(force.z + j, Lanes::sub(Lanes::loadu(force.z + j), fz));
+	}
+
+	//Springs of one kind from "count" consecutive nodes, whole vectors and then the rest one by one
+	template <class Lanes>
+	inline void springRun(const BasicSoAVec3<typename Lanes::T> &pos, const BasicSoAVec3<typename Lanes::T> &vel, BasicSoAVec3<typename Lanes::T> &force, int first, int count, int offset, float rest, const GridSpringParams &params) {
+
+		if (count <= 0) { return; } //Rows too short for the kind
+		int vectors = count / Lanes::width * Lanes::width;
+		for (int k = 0; k < vectors; k += Lanes::width) { springBatch<Lanes>(pos, vel, force, first + k, offset, rest, params.Ke, params.Kd); }
+		for (int k = vectors; k < count; k++) { springBatch<BasicScalarLanes<typename Lanes::T>>(pos, vel, force, first + k, offset, rest, params.Ke, params.Kd); }
+	}
+
+	//Rows and Columns are the size of a specialization, 0 takes the size of "grid" at runtime
+	template <class Lanes, int Rows, int Columns>
+	void gridForces(const BasicSoAVec3<typename Lanes::T> &pos, const BasicSoAVec3<typename Lanes::T> &vel, BasicSoAVec3<typename Lanes::T> &force, ClothGrid grid, int firstRow, int lastRow, const GridSpringParams &params) {
+
+		const int rows = Rows ? Rows : grid.rows;
+		const int columns = Columns ? Columns : grid.columns;
+
+		//The springs of buildSprings, each kind is a run of nodes of the row with a constant offset
+		for (int row = firstRow; row < lastRow; row++) {
+			int i = row * columns;
+			springRun<Lanes>(pos, vel, force, i, columns - 1, 1, params.structural, params);
+			if (row + 1 < rows) {
+				springRun<Lanes>(pos, vel, force, i, columns, columns, params.structural, params);
+				springRun<Lanes>(pos, vel, force, i, columns - 1, columns + 1, params.shear, params);
+				springRun<Lanes>(pos, vel, force, i + 1, columns - 1, columns - 1, params.shear, params);
+			}
+			springRun<Lanes>(pos, vel, force, i, columns - 2, 2, params.bending, params);
+			if (row + 2 < rows) { springRun<Lanes>(pos, vel, force, i, columns, 2 * columns, params.bending, params); }
+		}
+	}
+
+	//Kernels of every path, Scalar, SSE and AVX2 in the order of KernelPath, with the float or the double lanes ("Lanes" or
+	//"LanesDouble"). Paths not compiled in use the scalar one
+#if defined(CLOTH_SSE)
+#define GRID_SSE(lanes, rows, columns) gridForces<SSE##lanes, rows, columns>
+#else
+#define GRID_SSE(lanes, rows, columns) gridForces<Scalar##lanes, rows, columns>
+#endif
+#if defined(CLOTH_AVX2)
+#define GRID_AVX2(lanes, rows, columns) gridForces<AVX2##lanes, rows, columns>
+#else
+#define GRID_AVX2(lanes, rows, columns) GRID_SSE(lanes, rows, columns)
+#endif
+#define GRID_KERNELS(lanes, rows, columns) { rows, columns, { gridForces<Scalar##lanes, rows, columns>, GRID_SSE(lanes, rows, columns), GRID_AVX2(lanes, rows, columns) } }
+
+	//The default mesh of the application, both ways, and the usual square garment resolutions
+#define GRID_SPECIALIZATIONS(lanes) { \
+		GRID_KERNELS(lanes, 18, 14), \
+		GRID_KERNELS(lanes, 14, 18), \
+		GRID_KERNELS(lanes, 32, 32), \
+		GRID_KERNELS(lanes, 64, 64), \
+		GRID_KERNELS(lanes, 128, 128), \
+		GRID_KERNELS(lanes, 256, 256), \
+	}
+
+	template <class Real>
+	struct GridSpecialization {
+		int rows, columns;
+		BasicGridForceKernel<Real> kernels[3];
+	};
+
+	const GridSpecialization<float> specializations[] = GRID_SPECIALIZATIONS(Lanes);
+	const GridSpecialization<float> runtimeSized = GRID_KERNELS(Lanes, 0, 0);
+	const GridSpecialization<double> specializationsDouble[] = GRID_SPECIALIZATIONS(LanesDouble);
+	const GridSpecialization<double> runtimeSizedDouble = GRID_KERNELS(LanesDouble, 0, 0);
+
+	template <class Real, size_t count>
+	BasicGridForceKernel<Real> findKernel(const GridSpecialization<Real> (&table)[count], const GridSpecialization<Real> &generic, KernelPath path, ClothGrid grid, bool *specialized) {
+
+		for (const GridSpecialization<Real> &specialization : table) {
+			if (specialization.rows == grid.rows && specialization.columns == grid.columns) {
+				if (specialized) { *specialized = true; }
+				return specialization.kernels[(int)path];
+			}
+		}
+		if (specialized) { *specialized = false; }
+		return generic.kernels[(int)path];
+	}
+}
+
+GridForceKernel gridForceKernel(KernelPath path, ClothGrid grid, bool *specialized) {
+
+	return findKernel(specializations, runtimeSized, path, grid, specialized);
+}
+
+GridForceKernelDouble gridForceKernelDouble(KernelPath path, ClothGrid grid, bool *specialized) {
+
+	return findKernel(specializationsDouble, runtimeSizedDouble, path, grid, specialized);
+}
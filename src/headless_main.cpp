@@ -0,0 +1,327 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+#include "cloth_simulation.h"
+#include "cloth_world.h"
+#include "cloth_ensemble.h"
+#include "profiler.h"
+
+//Command line driver of the cloth solver, without window, GL or ImGui. Runs a fixed number of steps and
+//prints the time of every step and the throughput, for batch jobs and benchmarks on servers
+
+namespace {
+
+	void printUsage(const char *program) {
+
+		printf("Usage: %s [options]\n", program);
+		printf("  --rows N              Mesh rows (18)\n");
+		printf("  --columns N           Mesh columns (14)\n");
+		printf("  --steps N             Steps to run (300)\n");
+		printf("  --dt S                Fixed step in seconds (1/60)\n");
+		printf("  --integrator NAME     explicit, symplectic, verlet, rk4, implicit, xpbd or pd (symplectic)\n");
+		printf("  --precision NAME      float, mixed (double positions, symplectic and implicit) or double (symplectic) (float)\n");
+		printf("  --compare-double      Also run the steps in double precision and print how far the nodes end from it (symplectic)\n");
+		printf("  --Ke K                Stiffness (100)\n");
+		printf("  --Kd D                Damping (0.5)\n");
+		printf("  --L D                 Rest distance (0.3)\n");
+		printf("  --max-elongation P    Max elongation in %% (50)\n");
+		printf("  --strain-iterations N Max strain limiting sweeps (80)\n");
+		printf("  --strain-tolerance F  Stretch left over the max elongation, fraction of the rest length (0.05)\n");
+		printf("  --substeps N          XPBD substeps (10)\n");
+		printf("  --iterations N        XPBD and Projective Dynamics iterations (1)\n");
+		printf("  --threads N           Physics threads, including the main one (all)\n");
+		printf("  --instances N         Step N cloths in a world, one thread each. The k-th has (k %% 4 + 1) / 4 of the rows and columns\n");
+		printf("  --self-collision T    Keep the nodes at T from the cloth triangles\n");
+		printf("  --broadphase NAME     Self-collision candidates from the bvh or a hash (bvh)\n");
+		printf("  --bvh-rebuild R       Rebuild the BVH when its cost grows R times (2)\n");
+		printf("  --discrete            Only test the end of every step for collisions, no swept tests\n");
+		printf("  --scalar              Use the scalar kernels instead of SIMD\n");
+		printf("  --spring-list         Spring forces from the spring list instead of the grid kernels\n");
+		printf("  --sweep FILE          Step one instance per line \"Ke,Kd,elasticity,maxElongation\" of FILE as an ensemble and print their metrics\n");
+		printf("  --lanes N             Instances stepped together by the sweep, 8 or 16 (8)\n");
+		printf("  --profile-csv FILE    Write the profiler timers of every step to FILE (builds with CLOTH_PROFILING)\n");
+		printf("  --trace FILE          Write a Chrome trace of the run to FILE (builds with CLOTH_PROFILING)\n");
+		printf("  --quiet               Only print the summary\n");
+	}
+
+	double checksum(const ParticleState &nodes) {
+
+		//Sum of the positions, to compare runs
+		double sum = 0;
+		for (int i = 0; i < nodes.count; i++) {
+			glm::vec3 position = nodes.pos.get(i);
+			sum += position.x + position.y + position.z;
+		}
+		return sum;
+	}
+
+	void printProfile(const char *trace) {
+
+		Profiler &profiler = Profiler::instance();
+		for (int t = 0; t < profiler.timerCount(); t++) {
+			ProfileStats stats = profiler.stats(t);
+			printf("%s: min %.3f, avg %.3f, p99 %.3f ms over the last %d\n", profiler.name(t), stats.min, stats.avg, stats.p99, stats.samples);
+		}
+		profiler.stopCsv();
+		if (Tracer::instance().recording() && !Tracer::instance().write(trace)) { fprintf(stderr, "Can't write %s\n", trace); }
+	}
+
+	void printPrecisionError(const ClothSimulation &simulation, int steps, float dt) {
+
+		//The same steps with the double state, the closest to the exact solution of the solver
+		ClothSimulation reference;
+		reference.params = simulation.params;
+		reference.params.precision = Precision::Double;
+		reference.allocate(simulation.grid);
+		for (int step = 0; step < steps; step++) { reference.step(dt); }
+
+		double maxError = 0, squares = 0;
+		for (int i = 0; i < simulation.nodes.count; i++) {
+			glm::dvec3 exact = reference.statePrecision == Precision::Float ? glm::dvec3(reference.nodes.pos.get(i)) : reference.precise.pos.get(i);
+			glm::dvec3 position = simulation.statePrecision == Precision::Float ? glm::dvec3(simulation.nodes.pos.get(i)) : simulation.precise.pos.get(i);
+			glm::dvec3 error = position - exact;
+			maxError = glm::max(maxError, glm::length(error));
+			squares += glm::dot(error, error);
+		}
+		printf("%s precision ends %.3g from %s (max), %.3g rms\n", precisionName(simulation.activePrecision()), maxError,
+			precisionName(reference.activePrecision()), glm::sqrt(squares / simulation.nodes.count));
+		reference.release();
+	}
+
+	bool runSweep(ClothGrid grid, const ClothParams &params, const char *path, int lanes, int steps, float dt) {
+
+		FILE *file = fopen(path, "r");
+		if (!file) {
+			fprintf(stderr, "Can't read %s\n", path);
+			return false;
+		}
+		std::vector<EnsembleMaterial> materials;
+		char line[256];
+		while (fgets(line, sizeof(line), file)) {
+			EnsembleMaterial material;
+			if (sscanf(line, "%f,%f,%f,%d", &material.Ke, &material.Kd, &material.elasticity, &material.maxElongation) == 4) { materials.push_back(material); }
+		}
+		fclose(file);
+		if (materials.empty()) {
+			fprintf(stderr, "No materials in %s\n", path);
+			return false;
+		}
+
+		ClothEnsemble ensemble;
+		ensemble.mesh.params = params;
+		ensemble.lanes = lanes;
+		ensemble.allocate(grid, materials);
+		printf("%d instances of %dx%d nodes, %d lanes, %s kernels, %d threads, dt %g\n", (int)materials.size(), grid.rows, grid.columns, ensemble.lanes,
+			kernelPathName(ensemble.mesh.kernelPath()), params.threads, dt);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int step = 0; step < steps; step++) {
+			ensemble.step(dt);
+			Profiler::instance().endFrame();
+		}
+		double totalTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		double nodeSteps = (double)grid.totalVertex() * materials.size() * steps;
+		printf("%d steps in %.3f ms, %.3f ms/step, %.0f node-steps/s\n", steps, totalTime, totalTime / steps, nodeSteps / (totalTime / 1000));
+
+		printf("instance,Ke,Kd,elasticity,maxElongation,sag,maxStrain,energy\n");
+		for (int k = 0; k < (int)materials.size(); k++) {
+			const EnsembleMaterial &material = materials[k];
+			EnsembleMetrics metrics = ensemble.metrics(k);
+			printf("%d,%g,%g,%g,%d,%.6f,%.6f,%.6f\n", k, material.Ke, material.Kd, material.elasticity, material.maxElongation, metrics.sag, metrics.maxStrain, metrics.energy);
+		}
+		ensemble.release();
+		return true;
+	}
+
+	void runWorld(ClothGrid grid, const ClothParams &params, int instances, int steps, float dt, bool quiet) {
+
+		//Cloths of four sizes, so the threads get uneven work
+		ClothWorld world;
+		world.threads = params.threads;
+		for (int k = 0; k < instances; k++) {
+			int scale = k % 4 + 1;
+			ClothGrid size = { glm::max(minClothSide, grid.rows * scale / 4), glm::max(minClothSide, grid.columns * scale / 4) };
+			world.add(size, params);
+		}
+		printf("%d cloths, %d nodes, %s, %d threads, dt %g\n", instances, world.totalNodes(), integratorName(params.integrator), world.threads, dt);
+
+		double totalTime = 0;
+		long long steals = 0;
+		for (int step = 0; step < steps; step++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			world.step(dt);
+			double stepTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			totalTime += stepTime;
+			steals += world.pool.steals();
+			Profiler::instance().endFrame();
+			if (!quiet) { printf("step %d %.3f ms, %lld instances stolen\n", step, stepTime, world.pool.steals()); }
+		}
+
+		double sum = 0, busy = 0;
+		for (const std::unique_ptr<ClothInstance> &instance : world.instances) {
+			sum += checksum(instance->simulation.nodes);
+			busy += instance->stepTime;
+		}
+		double nodeSteps = (double)world.totalNodes() * steps;
+		printf("%d steps in %.3f ms, %.3f ms/step, %.0f node-steps/s\n", steps, totalTime, totalTime / steps, nodeSteps / (totalTime / 1000));
+		printf("%.1f instances stolen per step, %.3f ms of instance steps on the last one\n", (double)steals / steps, busy);
+		printf("checksum %.6f\n", sum);
+		world.clear();
+	}
+}
+
+int main(int argc, char **argv) {
+
+	ClothSimulation simulation;
+	ClothParams &params = simulation.params;
+	ClothGrid grid = { 18, 14 };
+	int steps = 300;
+	float dt = 1.f / 60;
+	bool quiet = false;
+	int instances = 0;
+	const char *sweep = nullptr;
+	int lanes = 8;
+	const char *profileCsv = nullptr;
+	const char *trace = nullptr;
+	bool compareDouble = false;
+
+	for (int i = 1; i < argc; i++) {
+		const char *option = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		bool needsValue = true;
+
+		if (strcmp(option, "--scalar") == 0) { params.useSimd = false; needsValue = false; }
+		else if (strcmp(option, "--spring-list") == 0) { params.gridKernels = false; needsValue = false; }
+		else if (strcmp(option, "--discrete") == 0) { params.continuousCollisions = false; needsValue = false; }
+		else if (strcmp(option, "--compare-double") == 0) { compareDouble = true; needsValue = false; }
+		else if (strcmp(option, "--quiet") == 0) { quiet = true; needsValue = false; }
+		else if (strcmp(option, "--help") == 0) { printUsage(argv[0]); return 0; }
+		else if (!value) { fprintf(stderr, "Missing value for %s\n", option); return 1; }
+		else if (strcmp(option, "--rows") == 0) { grid.rows = atoi(value); }
+		else if (strcmp(option, "--columns") == 0) { grid.columns = atoi(value); }
+		else if (strcmp(option, "--steps") == 0) { steps = atoi(value); }
+		else if (strcmp(option, "--dt") == 0) { dt = (float)atof(value); }
+		else if (strcmp(option, "--Ke") == 0) { params.Ke = atoi(value); }
+		else if (strcmp(option, "--Kd") == 0) { params.Kd = (float)atof(value); }
+		else if (strcmp(option, "--L") == 0) { params.L = (float)atof(value); }
+		else if (strcmp(option, "--max-elongation") == 0) { params.maxElongation = atoi(value); }
+		else if (strcmp(option, "--strain-iterations") == 0) { params.strainIterations = atoi(value); }
+		else if (strcmp(option, "--strain-tolerance") == 0) { params.strainTolerance = (float)atof(value); }
+		else if (strcmp(option, "--substeps") == 0) { params.solverSubsteps = atoi(value); }
+		else if (strcmp(option, "--iterations") == 0) { params.constraintIterations = atoi(value); }
+		else if (strcmp(option, "--threads") == 0) { params.threads = atoi(value); }
+		else if (strcmp(option, "--instances") == 0) { instances = atoi(value); }
+		else if (strcmp(option, "--sweep") == 0) { sweep = value; }
+		else if (strcmp(option, "--lanes") == 0) { lanes = atoi(value); }
+		else if (strcmp(option, "--self-collision") == 0) { params.selfCollision = true; params.selfThickness = (float)atof(value); }
+		else if (strcmp(option, "--profile-csv") == 0) { profileCsv = value; }
+		else if (strcmp(option, "--trace") == 0) { trace = value; }
+		else if (strcmp(option, "--bvh-rebuild") == 0) { simulation.bvh.rebuildRatio = (float)atof(value); }
+		else if (strcmp(option, "--broadphase") == 0) {
+			if (strcmp(value, "bvh") == 0) { params.selfBroadphase = SelfCollisionBroadphase::BVH; }
+			else if (strcmp(value, "hash") == 0) { params.selfBroadphase = SelfCollisionBroadphase::SpatialHash; }
+			else { fprintf(stderr, "Unknown broadphase %s\n", value); return 1; }
+		}
+		else if (strcmp(option, "--integrator") == 0) {
+			if (!parseIntegratorOption(value, params.integrator)) { fprintf(stderr, "Unknown integrator %s\n", value); return 1; }
+		}
+		else if (strcmp(option, "--precision") == 0) {
+			if (!parsePrecisionOption(value, params.precision)) { fprintf(stderr, "Unknown precision %s\n", value); return 1; }
+		}
+		else {
+			fprintf(stderr, "Unknown option %s\n", option);
+			printUsage(argv[0]);
+			return 1;
+		}
+		if (needsValue) { i++; }
+	}
+
+	if (grid.rows < minClothSide || grid.columns < minClothSide || grid.rows > maxClothSide || grid.columns > maxClothSide) {
+		fprintf(stderr, "The mesh sides must be between %d and %d\n", minClothSide, maxClothSide);
+		return 1;
+	}
+	if (lanes != 8 && lanes != 16) {
+		fprintf(stderr, "The lanes must be 8 or 16\n");
+		return 1;
+	}
+	if (steps <= 0 || dt <= 0) {
+		fprintf(stderr, "Steps and dt must be positive\n");
+		return 1;
+	}
+	if (simulation.activePrecision() != params.precision) {
+		fprintf(stderr, "%s has no %s precision path, it would run in %s\n", integratorName(params.integrator), precisionName(params.precision),
+			precisionName(simulation.activePrecision()));
+		return 1;
+	}
+	if (compareDouble && params.integrator != IntegratorType::SymplecticEuler) {
+		fprintf(stderr, "--compare-double needs the symplectic integrator, the only one with a double precision path\n");
+		return 1;
+	}
+	params.threads = glm::max(1, params.threads);
+#ifndef CLOTH_PROFILING
+	if (profileCsv || trace) { fprintf(stderr, "Built without CLOTH_PROFILING, --profile-csv and --trace are ignored\n"); }
+#else
+	if (profileCsv && !Profiler::instance().startCsv(profileCsv)) {
+		fprintf(stderr, "Can't write %s\n", profileCsv);
+		return 1;
+	}
+	TRACE_THREAD_NAME("Main");
+	if (trace) { Tracer::instance().start(); }
+#endif
+
+	if (sweep) {
+		bool done = runSweep(grid, params, sweep, lanes, steps, dt);
+		printProfile(trace);
+		return done ? 0 : 1;
+	}
+	if (instances > 0) {
+		runWorld(grid, params, instances, steps, dt, quiet);
+		printProfile(trace);
+		return 0;
+	}
+
+	simulation.allocate(grid);
+	printf("%dx%d nodes, %d springs, %s, %s precision, %s kernels, %d threads, dt %g\n", grid.rows, grid.columns, (int)simulation.springs.size(),
+		integratorName(params.integrator), precisionName(simulation.activePrecision()), kernelPathName(simulation.kernelPath()), params.threads, dt);
+
+	double totalTime = 0;
+	long long pairsTested = 0, contacts = 0, impacts = 0;
+	for (int step = 0; step < steps; step++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		simulation.step(dt);
+		double stepTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		totalTime += stepTime;
+		pairsTested += simulation.selfCollision.stats().pairsTested;
+		contacts += simulation.selfCollision.stats().contacts;
+		impacts += simulation.selfCollision.stats().impacts;
+		Profiler::instance().endFrame();
+
+		if (!quiet) {
+			const StepTimings &timings = simulation.timings;
+			printf("step %d %.3f ms (forces %.3f, integration %.3f, strain %.3f in %d sweeps, self-collision %.3f, collisions %.3f)\n", step, stepTime,
+				timings.forces, timings.integration, timings.strain, simulation.strainSweeps, timings.selfCollision, timings.collisions);
+			if (params.selfCollision) {
+				const SelfCollisionStats &stats = simulation.selfCollision.stats();
+				printf("  %lld pairs tested, %d contacts, %d continuous\n", stats.pairsTested, stats.contacts, stats.impacts);
+			}
+		}
+	}
+
+	double nodeSteps = (double)grid.totalVertex() * steps;
+	printf("%d steps in %.3f ms, %.3f ms/step, %.0f node-steps/s\n", steps, totalTime, totalTime / steps, nodeSteps / (totalTime / 1000));
+	const ClothBVHStats &tree = simulation.bvh.stats();
+	printf("bvh %d nodes, depth %d, cost %.2f (%.2f after the build), %d rebuilds\n", tree.nodes, tree.depth, tree.cost, tree.buildCost, tree.rebuilds);
+	if (params.selfCollision) {
+		printf("self-collision %.0f pairs tested and %.1f contacts (%.1f continuous) per step\n", (double)pairsTested / steps, (double)contacts / steps, (double)impacts / steps);
+	}
+	int fallbackSteps = simulation.integrator->stats().fallbackSteps;
+	if (fallbackSteps > 0) { printf("factorization failed, %d steps with symplectic Euler\n", fallbackSteps); }
+	printf("checksum %.6f\n", checksum(simulation.nodes));
+	if (compareDouble) { printPrecisionError(simulation, steps, dt); }
+	printProfile(trace);
+
+	simulation.release();
+	return 0;
+}
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cstring>
+
+#include "integrators.h"
+#include "block_sparse.h"
+
+const char *integratorName(IntegratorType type) {
+	switch (type) {
+	case IntegratorType::ExplicitEuler: return "Explicit Euler";
+	case IntegratorType::SymplecticEuler: return "Symplectic Euler";
+	case IntegratorType::Verlet: return "Verlet";
+	case IntegratorType::RK4: return "RK4";
+	case IntegratorType::ImplicitEuler: return "Implicit Euler";
+	case IntegratorType::XPBD: return "XPBD";
+	case IntegratorType::ProjectiveDynamics: return "Projective Dynamics";
+	default: return "";
+	}
+}
+
+const char *integratorOption(IntegratorType type) {
+	switch (type) {
+	case IntegratorType::ExplicitEuler: return "explicit";
+	case IntegratorType::SymplecticEuler: return "symplectic";
+	case IntegratorType::Verlet: return "verlet";
+	case IntegratorType::RK4: return "rk4";
+	case IntegratorType::ImplicitEuler: return "implicit";
+	case IntegratorType::XPBD: return "xpbd";
+	case IntegratorType::ProjectiveDynamics: return "pd";
+	default: return "";
+	}
+}
+
+bool parseIntegratorOption(const char *option, IntegratorType &type) {
+
+	for (int i = 0; i < integratorCount; i++) {
+		if (strcmp(option, integratorOption((IntegratorType)i)) == 0) {
+			type = (IntegratorType)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+namespace {
+
+	class ExplicitEulerIntegrator : public Integrator {
+	public:
+		IntegratorType type() const override { return IntegratorType::ExplicitEuler; }
+		void step(KernelPath path, ParticleState &state, const IntegrationContext&, float dt, glm::vec3 gravity) override {
+			integrateExplicitEuler(path, state, dt, gravity);
+		}
+	};
+
+	class SymplecticEulerIntegrator : public Integrator {
+	public:
+		IntegratorType type() const override { return IntegratorType::SymplecticEuler; }
+		void step(KernelPath path, ParticleState &state, const IntegrationContext&, float dt, glm::vec3 gravity) override {
+			integrateSymplecticEuler(path, state, dt, gravity);
+		}
+	};
+
+	//Position Verlet, the previous state is state.last. Velocities are derived from the positions for the damping and the collisions
+	class VerletIntegrator : public Integrator {
+	public:
+		IntegratorType type() const override { return IntegratorType::Verlet; }
+		void step(KernelPath path, ParticleState &state, const IntegrationContext&, float dt, glm::vec3 gravity) override {
+			integrateVerlet(path, state, dt, gravity);
+		}
+	};
+
+	//Classic 4th order Runge-Kutta, three extra force evaluations per step
+	class RK4Integrator : public Integrator {
+	public:
+		IntegratorType type() const override { return IntegratorType::RK4; }
+
+		void step(KernelPath path, ParticleState &state, const IntegrationContext &context, float dt, glm::vec3 gravity) override {
+
+			if (capacity != state.capacity) { allocate(state.capacity); }
+			clearSoA(sumPos, capacity);
+			clearSoA(sumVel, capacity);
+			copySoA(stagePos, state.pos, capacity);
+			copySoA(stageVel, state.vel, capacity);
+
+			//k1 on the current state, its forces are already evaluated. The forces of the next stages overwrite them,
+			//they are evaluated again at the start of the next step
+			SoAVec3 &stageForce = state.force;
+			rk4Stage(path, state, stagePos, stageVel, state.force, sumPos, sumVel, 1, dt / 2, gravity);
+			context.forces(stagePos, stageVel, stageForce);
+			rk4Stage(path, state, stagePos, stageVel, stageForce, sumPos, sumVel, 2, dt / 2, gravity);
+			context.forces(stagePos, stageVel, stageForce);
+			rk4Stage(path, state, stagePos, stageVel, stageForce, sumPos, sumVel, 2, dt, gravity);
+			context.forces(stagePos, stageVel, stageForce);
+			rk4Stage(path, state, stagePos, stageVel, stageForce, sumPos, sumVel, 1, 0, gravity);
+
+			rk4Finish(path, state, sumPos, sumVel, dt);
+		}
+
+	private:
+		void allocate(int nodes) {
+			capacity = nodes;
+			scratch.reserve(12, capacity);
+			stagePos = scratch.soa(0, capacity);
+			stageVel = scratch.soa(3, capacity);
+			sumPos = scratch.soa(6, capacity);
+			sumVel = scratch.soa(9, capacity);
+		}
+
+		int capacity = 0;
+		SoAArena scratch;
+		SoAVec3 stagePos = {}, stageVel = {};
+		SoAVec3 sumPos = {}, sumVel = {};
+	};
+	//Backward Euler (Baraff-Witkin): (M - h df/dv - h^2 df/dx) dv = h (f + M g + h df/dx v), solved with PCG.
+	//The spring Jacobians are assembled on a 3x3 block sparse matrix with the pattern of the spring list
+	class ImplicitEulerIntegrator : public Integrator {
+	public:
+		IntegratorType type() const override { return IntegratorType::ImplicitEuler; }
+		SolverStats stats() const override { return lastStats; }
+
+		void step(KernelPath, ParticleState &state, const IntegrationContext &context, float dt, glm::vec3 gravity) override {
+
+			const std::vector<Spring> &springs = *context.springs;
+			ThreadPool &pool = *context.pool;
+			//A resize to the transposed grid keeps the counts but not the pairs of nodes
+			if (matrix.rows != state.count || (int)springEntries.size() != 2 * (int)springs.size() || patternGrid != context.grid) {
+				buildPattern(state.count, springs);
+				patternGrid = context.grid;
+			}
+			const int n = state.count;
+			const float h = dt;
+
+			//Spring blocks: K = h Kd nn' + h^2 Ke (nn' + max(0, 1 - L/l) (I - nn')), stored as -K on (i, j) and (j, i)
+			pool.parallelFor((int)springs.size(), springGrain, [&](int begin, int end) {
+				for (int s = begin; s < end; s++) {
+					const Spring &spring = springs[s];
+					glm::vec3 delta = state.pos.get(spring.i) - state.pos.get(spring.j);
+					float length = glm::length(delta);
+					glm::vec3 normal = delta / length;
+					glm::mat3 nn = glm::outerProduct(normal, normal);
+
+					stiffness[s] = context.Ke * (nn + glm::max(0.f, 1 - spring.restLength / length) * (glm::mat3(1.f) - nn)); //-df/dx
+					glm::mat3 block = -(h * context.Kd * nn + h * h * stiffness[s]);
+					matrix.blocks[springEntries[2 * s]] = block;
+					matrix.blocks[springEntries[2 * s + 1]] = block;
+				}
+			});
+
+			//Diagonal blocks and right hand side, by rows
+			pool.parallelFor(n, rowGrain, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					glm::mat3 diagonal(1.f); //Unit mass
+					glm::vec3 vi = state.vel.get(i);
+					glm::vec3 rhs = state.force.get(i) + gravity;
+					for (int e = matrix.rowStart[i]; e < matrix.rowStart[i + 1]; e++) {
+						if (e == matrix.diagonal[i]) { continue; }
+						diagonal -= matrix.blocks[e];
+						rhs -= h * (stiffness[entrySpring[e]] * (vi - state.vel.get(matrix.column[e])));
+					}
+					matrix.blocks[matrix.diagonal[i]] = diagonal;
+					rightSide[i] = h * rhs;
+					filter[i] = state.invMass[i] > 0 ? 1.f : 0.f;
+					if (!context.warmStart) { deltaVel[i] = glm::vec3(0, 0, 0); }
+				}
+			});
+
+			CGResult result = solvePCG(matrix, rightSide.data(), deltaVel.data(), filter.data(), context.tolerance, context.maxIterations, pool);
+			lastStats.iterations = result.iterations;
+			lastStats.residual = result.residual;
+
+			//v += dv, x += h v
+			pool.parallelFor(n, rowGrain, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					glm::vec3 velocity = state.vel.get(i) + deltaVel[i];
+					state.last.set(i, state.pos.get(i));
+					state.vel.set(i, velocity);
+					state.pos.set(i, state.pos.get(i) + h * velocity);
+				}
+			});
+		}
+
+	private:
+		static const int springGrain = 4096;
+		static const int rowGrain = 4096;
+
+		void buildPattern(int nodes, const std::vector<Spring> &springs) {
+
+			//Every row has its diagonal block plus one block per spring of the node, sorted by column
+			std::vector<std::vector<std::pair<int, int>>> rowsSprings(nodes);
+			for (int s = 0; s < (int)springs.size(); s++) {
+				rowsSprings[springs[s].i].push_back({ springs[s].j, s });
+				rowsSprings[springs[s].j].push_back({ springs[s].i, s });
+			}
+
+			matrix.rows = nodes;
+			matrix.rowStart.assign(nodes + 1, 0);
+			matrix.column.clear();
+			matrix.diagonal.assign(nodes, 0);
+			entrySpring.clear();
+			springEntries.assign(2 * springs.size(), 0);
+
+			for (int i = 0; i < nodes; i++) {
+				rowsSprings[i].push_back({ i, -1 });
+				std::sort(rowsSprings[i].begin(), rowsSprings[i].end());
+				for (const std::pair<int, int> &entry : rowsSprings[i]) {
+					int e = (int)matrix.column.size();
+					if (entry.second < 0) { matrix.diagonal[i] = e; }
+					else { springEntries[2 * entry.second + (i == springs[entry.second].i ? 0 : 1)] = e; }
+					matrix.column.push_back(entry.first);
+					entrySpring.push_back(entry.second);
+				}
+				matrix.rowStart[i + 1] = (int)matrix.column.size();
+			}
+
+			matrix.blocks.assign(matrix.column.size(), glm::mat3(0.f));
+			stiffness.assign(springs.size(), glm::mat3(0.f));
+			rightSide.assign(nodes, glm::vec3(0, 0, 0));
+			deltaVel.assign(nodes, glm::vec3(0, 0, 0));
+			filter.assign(nodes, 0.f);
+		}
+
+		BlockSparseMatrix matrix;
+		ClothGrid patternGrid = { 0, 0 };
+		std::vector<int> springEntries; //Entries (i, j) and (j, i) of every spring
+		std::vector<int> entrySpring;   //Spring of every entry, -1 for the diagonal
+		std::vector<glm::mat3> stiffness; //-df/dx of every spring
+		std::vector<glm::vec3> rightSide;
+		std::vector<glm::vec3> deltaVel; //Kept between steps for the warm start
+		std::vector<float> filter;
+		SolverStats lastStats;
+	};
+}
+
+std::unique_ptr<Integrator> createIntegrator(IntegratorType type) {
+
+	switch (type) {
+	case IntegratorType::ExplicitEuler: return std::unique_ptr<Integrator>(new ExplicitEulerIntegrator());
+	case IntegratorType::Verlet: return std::unique_ptr<Integrator>(new VerletIntegrator());
+	case IntegratorType::RK4: return std::unique_ptr<Integrator>(new RK4Integrator());
+	case IntegratorType::ImplicitEuler: return std::unique_ptr<Integrator>(new ImplicitEulerIntegrator());
+	case IntegratorType::XPBD: return createXPBDSolver();
+	case IntegratorType::ProjectiveDynamics: return createPDSolver();
+	default: return std::unique_ptr<Integrator>(new SymplecticEulerIntegrator());
+	}
+}
@@ -0,0 +1,160 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "cloth_simulation.h"
+#include "grid_kernels.h"
+
+//Checks that every kernel path gives the results of the scalar one: the spring forces from the spring list and from the
+//grid kernels (float and double) on every compiled instruction set, the integration kernels and the collisions.
+//Differences are relative to the largest value of the reference, the exit code is 1 when one is over the tolerance
+
+namespace {
+
+	struct CheckOptions {
+		std::vector<ClothGrid> grids = { { 18, 14 }, { 14, 18 }, { 37, 29 }, { 64, 64 } };
+		int warmupSteps = 60; //Away from the flat rest state, with the cloth on the colliders
+		double tolerance = 1e-4;
+	};
+
+	int failures = 0, checks = 0;
+
+	void copyState(ParticleState &destination, const ParticleState &source) {
+
+		destination.allocate(source.count);
+		copySoA(destination.pos, source.pos, source.capacity);
+		copySoA(destination.vel, source.vel, source.capacity);
+		copySoA(destination.force, source.force, source.capacity);
+		copySoA(destination.last, source.last, source.capacity);
+		memcpy(destination.invMass, source.invMass, sizeof(float) * source.capacity);
+	}
+
+	//Max difference of two arrays of nodes over the largest value of the reference
+	template <class Real>
+	double relativeDifference(const BasicSoAVec3<Real> &values, const SoAVec3 &reference, int count) {
+
+		double difference = 0, scale = 0;
+		for (int i = 0; i < count; i++) {
+			glm::dvec3 expected = glm::dvec3(reference.get(i));
+			difference = glm::max(difference, glm::length(glm::dvec3(values.get(i)) - expected));
+			scale = glm::max(scale, glm::length(expected));
+		}
+		return scale > 0 ? difference / scale : difference;
+	}
+
+	void report(const char *name, ClothGrid grid, KernelPath path, double difference, const CheckOptions &options) {
+
+		bool passed = difference <= options.tolerance;
+		checks++;
+		if (!passed) { failures++; }
+		printf("%-4s %-26s %3dx%-3d %-6s %.3g\n", passed ? "ok" : "FAIL", name, grid.rows, grid.columns, kernelPathName(path), difference);
+	}
+
+	void checkGrid(ClothGrid grid, const CheckOptions &options) {
+
+		ClothSimulation simulation;
+		simulation.params.threads = 1;
+		simulation.allocate(grid);
+		for (int i = 0; i < options.warmupSteps; i++) { simulation.step(1.f / 60); }
+		ParticleState &nodes = simulation.nodes;
+		const float L = simulation.springsL;
+		const GridSpringParams springParams = { L, sqrtf(L*L + L*L), L * 2, (float)simulation.params.Ke, simulation.params.Kd };
+		const float dt = 1.f / 60;
+		const glm::vec3 gravity(0, -9.81f, 0);
+
+		//References of the scalar path
+		ParticleState reference;
+		copyState(reference, nodes);
+		reference.clearForces();
+		accumulateSpringForces(KernelPath::Scalar, reference.pos, reference.vel, reference.force, simulation.springs.data(), (int)simulation.springs.size(), springParams.Ke, springParams.Kd);
+
+		ParticleState symplectic, explicitEuler, verlet, collided;
+		copyState(symplectic, reference); integrateSymplecticEuler(KernelPath::Scalar, symplectic, dt, gravity);
+		copyState(explicitEuler, reference); integrateExplicitEuler(KernelPath::Scalar, explicitEuler, dt, gravity);
+		copyState(verlet, reference); integrateVerlet(KernelPath::Scalar, verlet, dt, gravity);
+		copyState(collided, symplectic);
+		collideNodes(KernelPath::Scalar, collided, 0, collided.capacity, simulation.colliders.data(), (int)simulation.colliders.size(), dt, true);
+
+		ParticleState state;
+		SoAArenaDouble preciseArena;
+		preciseArena.reserve(9, reference.capacity);
+		SoAVec3Double precisePos = preciseArena.soa(0, reference.capacity), preciseVel = preciseArena.soa(3, reference.capacity), preciseForce = preciseArena.soa(6, reference.capacity);
+		for (int i = 0; i < reference.capacity; i++) {
+			precisePos.set(i, glm::dvec3(reference.pos.get(i)));
+			preciseVel.set(i, glm::dvec3(reference.vel.get(i)));
+		}
+
+		for (int p = 0; p <= (int)bestKernelPath(); p++) {
+			KernelPath path = (KernelPath)p;
+
+			copyState(state, reference);
+			state.clearForces();
+			accumulateSpringForces(path, state.pos, state.vel, state.force, simulation.springs.data(), (int)simulation.springs.size(), springParams.Ke, springParams.Kd);
+			report("Spring list forces", grid, path, relativeDifference(state.force, reference.force, state.count), options);
+
+			state.clearForces();
+			gridForceKernel(path, grid)(state.pos, state.vel, state.force, grid, 0, grid.rows, springParams);
+			report("Grid forces", grid, path, relativeDifference(state.force, reference.force, state.count), options);
+
+			clearSoA(preciseForce, reference.capacity);
+			gridForceKernelDouble(path, grid)(precisePos, preciseVel, preciseForce, grid, 0, grid.rows, springParams);
+			report("Grid forces (double)", grid, path, relativeDifference(preciseForce, reference.force, state.count), options);
+
+			copyState(state, reference);
+			integrateSymplecticEuler(path, state, dt, gravity);
+			report("Symplectic Euler", grid, path, glm::max(relativeDifference(state.pos, symplectic.pos, state.count), relativeDifference(state.vel, symplectic.vel, state.count)), options);
+
+			copyState(state, reference);
+			integrateExplicitEuler(path, state, dt, gravity);
+			report("Explicit Euler", grid, path, glm::max(relativeDifference(state.pos, explicitEuler.pos, state.count), relativeDifference(state.vel, explicitEuler.vel, state.count)), options);
+
+			copyState(state, reference);
+			integrateVerlet(path, state, dt, gravity);
+			report("Verlet", grid, path, glm::max(relativeDifference(state.pos, verlet.pos, state.count), relativeDifference(state.vel, verlet.vel, state.count)), options);
+
+			copyState(state, symplectic);
+			collideNodes(path, state, 0, state.capacity, simulation.colliders.data(), (int)simulation.colliders.size(), dt, true);
+			report("Collisions", grid, path, glm::max(relativeDifference(state.pos, collided.pos, state.count), relativeDifference(state.vel, collided.vel, state.count)), options);
+		}
+		simulation.release();
+	}
+
+	void printUsage(const char *program) {
+
+		printf("Usage: %s [options]\n", program);
+		printf("  --grids LIST       Comma separated rowsxcolumns (18x14,14x18,37x29,64x64)\n");
+		printf("  --tolerance F      Max difference with the scalar path, relative to its largest value (1e-4)\n");
+	}
+}
+
+int main(int argc, char **argv) {
+
+	CheckOptions options;
+	for (int i = 1; i < argc; i++) {
+		const char *option = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(option, "--help") == 0) { printUsage(argv[0]); return 0; }
+		if (!value) {
+			fprintf(stderr, "Missing value for %s\n", option);
+			return 1;
+		}
+		i++;
+
+		if (strcmp(option, "--grids") == 0) {
+			if (!parseGridList(value, options.grids)) { fprintf(stderr, "Bad grid list %s\n", value); return 1; }
+		}
+		else if (strcmp(option, "--tolerance") == 0) { options.tolerance = atof(value); }
+		else {
+			fprintf(stderr, "Unknown option %s\n", option);
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	printf("Paths up to %s, tolerance %g\n", kernelPathName(bestKernelPath()), options.tolerance);
+	for (ClothGrid grid : options.grids) { checkGrid(grid, options); }
+	printf("%d of %d checks over the tolerance\n", failures, checks);
+	return failures > 0 ? 1 : 0;
+}
@@ -6,6 +6,7 @@
 #include <cstdio>
 
 #include "GL_framework.h"
+#include "profiler.h"
 
 static GLFWwindow *window;
 
@@ -21,11 +22,12 @@ extern void GLcleanup();
 extern void GLrender();
 
 namespace {
-	const int expected_fps = 30;
+	const int expected_fps = 60;
 	const double expected_frametime = 1.0 / expected_fps;
 	double prev_frametimestamp = 0;
 	double curr_frametimestamp = 0;
 	double wait_time_ms = 1e3 * expected_frametime;
+	double prev_physicstimestamp = 0; //The physics consume the real frame time
 
 	void waitforFrameEnd() {
 		curr_frametimestamp = glfwGetTime();
@@ -78,14 +80,21 @@ int main(int argc, char** argv){
 	// Setup ImGui binding
 	ImGui_ImplGlfwGL3_Init(window, true);
 
+	TRACE_THREAD_NAME("Main");
 	prev_frametimestamp = glfwGetTime();
+	prev_physicstimestamp = prev_frametimestamp;
 	while(!glfwWindowShouldClose(window)) { // Loop until the user closes the window
 		glfwPollEvents(); // Poll for events
 		ImGui_ImplGlfwGL3_NewFrame();
 		
 		ImGuiIO& io = ImGui::GetIO();
-		GUI();
-		PhysicsUpdate((float)expected_frametime);
+		{
+			PROFILE_SCOPE("GUI");
+			GUI();
+		}
+		double physicstimestamp = glfwGetTime();
+		PhysicsUpdate((float)(physicstimestamp - prev_physicstimestamp));
+		prev_physicstimestamp = physicstimestamp;
 		if(!io.WantCaptureMouse) {
 			MouseEvent ev = {io.MousePos.x, io.MousePos.y, 
 				(io.MouseDown[0] ? MouseEvent::Button::Left : 
@@ -94,9 +103,13 @@ int main(int argc, char** argv){
 				MouseEvent::Button::None)))};
 			GLmousecb(ev);
 		}
-		GLrender();
+		{
+			PROFILE_SCOPE("GLrender");
+			GLrender();
+		}
 	
 		glfwSwapBuffers(window);//Swap front and back buffers
+		Profiler::instance().endFrame(); //One CSV row per frame
 		waitforFrameEnd();
 	}
 	ImGui_ImplGlfwGL3_Shutdown();
@@ -0,0 +1,90 @@
+#include <xmmintrin.h>
+#include <cstring>
+
+#include "particle_state.h"
+
+template <class Real>
+Real *BasicSoAArena<Real>::reserve(int arrays, int capacity) {
+
+	size_t elements = (size_t)arrays * stride(capacity);
+	if (elements > reserved) {
+		release();
+		block = (Real*)_mm_malloc(sizeof(Real) * elements, simdAlignment);
+		reserved = elements;
+	}
+	memset(block, 0, sizeof(Real) * elements);
+	return block;
+}
+
+template <class Real>
+BasicSoAVec3<Real> BasicSoAArena<Real>::soa(int first, int capacity) const {
+
+	int s = stride(capacity);
+	return { block + (size_t)first * s, block + (size_t)(first + 1) * s, block + (size_t)(first + 2) * s };
+}
+
+template <class Real>
+void BasicSoAArena<Real>::release() {
+
+	if (block) { _mm_free(block); }
+	block = nullptr;
+	reserved = 0;
+}
+
+template <class Real>
+void clearSoA(BasicSoAVec3<Real> &v, int capacity) {
+
+	memset(v.x, 0, sizeof(Real) * capacity);
+	memset(v.y, 0, sizeof(Real) * capacity);
+	memset(v.z, 0, sizeof(Real) * capacity);
+}
+
+template <class Real>
+void copySoA(BasicSoAVec3<Real> &destination, const BasicSoAVec3<Real> &source, int capacity) {
+
+	memcpy(destination.x, source.x, sizeof(Real) * capacity);
+	memcpy(destination.y, source.y, sizeof(Real) * capacity);
+	memcpy(destination.z, source.z, sizeof(Real) * capacity);
+}
+
+template class BasicSoAArena<float>;
+template class BasicSoAArena<double>;
+template void clearSoA(SoAVec3 &v, int capacity);
+template void clearSoA(SoAVec3Double &v, int capacity);
+template void copySoA(SoAVec3 &destination, const SoAVec3 &source, int capacity);
+template void copySoA(SoAVec3Double &destination, const SoAVec3Double &source, int capacity);
+
+void ParticleState::allocate(int nodes) {
+
+	count = nodes;
+	capacity = (nodes + simdWidth - 1) / simdWidth * simdWidth;
+
+	float *block = arena.reserve(13, capacity);
+	pos = arena.soa(0, capacity);
+	vel = arena.soa(3, capacity);
+	force = arena.soa(6, capacity);
+	last = arena.soa(9, capacity);
+	invMass = block + (size_t)12 * SoAArena::stride(capacity);
+}
+
+void ParticleState::release() {
+
+	arena.release();
+	pos = vel = force = last = {};
+	invMass = nullptr;
+	count = capacity = 0;
+}
+
+void ParticleState::clearForces() {
+
+	clearSoA(force, capacity);
+}
+
+void ParticleState::packPositions(float *xyz) const {
+
+	for (int i = 0; i < count; i++) {
+		xyz[3 * i + 0] = pos.x[i];
+		xyz[3 * i + 1] = pos.y[i];
+		xyz[3 * i + 2] = pos.z[i];
+	}
+}
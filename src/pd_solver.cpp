@@ -0,0 +1,219 @@
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "integrators.h"
+#include "sparse_cholesky.h"
+
+namespace {
+
+	//Nested dissection of the sub-grid [row0, row1) x [column0, column1). Bending springs reach two nodes away,
+	//so the separators are two rows (or columns) thick. Both halves first, the separator last
+	void dissect(int row0, int row1, int column0, int column1, const ClothGrid &grid, std::vector<int> &order) {
+
+		int height = row1 - row0, width = column1 - column0;
+		if (height <= 0 || width <= 0) { return; }
+
+		if (height * width <= 64) {
+			for (int row = row0; row < row1; row++) {
+				for (int col = column0; col < column1; col++) { order.push_back(grid.index(row, col)); }
+			}
+			return;
+		}
+
+		if (height >= width) {
+			int separator = row0 + (height - 2) / 2;
+			dissect(row0, separator, column0, column1, grid, order);
+			dissect(separator + 2, row1, column0, column1, grid, order);
+			dissect(separator, separator + 2, column0, column1, grid, order);
+		}
+		else {
+			int separator = column0 + (width - 2) / 2;
+			dissect(row0, row1, column0, separator, grid, order);
+			dissect(row0, row1, separator + 2, column1, grid, order);
+			dissect(row0, row1, separator, separator + 2, grid, order);
+		}
+	}
+
+	//Projective Dynamics: every spring is projected to its rest length (local step, in parallel) and the positions
+	//solve (M / h^2 + Ke * sum(A'A)) x = M / h^2 * y + Ke * sum(A'p) (global step). The matrix only depends on
+	//the topology, Ke, h and the fixed nodes, so it's factorized once and every iteration is a back-substitution.
+	//Fixed nodes are removed from the system and their springs go to the right side.
+	//Kd isn't used, the implicit step already damps the motion
+	class ProjectiveDynamicsSolver : public Integrator {
+	public:
+		IntegratorType type() const override { return IntegratorType::ProjectiveDynamics; }
+		bool usesForces() const override { return false; }
+		SolverStats stats() const override { return lastStats; }
+
+		void step(KernelPath path, ParticleState &state, const IntegrationContext &context, float dt, glm::vec3 gravity) override {
+
+			const std::vector<Spring> &springs = *context.springs;
+			ThreadPool &pool = *context.pool;
+			const int n = state.count;
+			const float h = dt;
+
+			if (!factorizationValid(state, context, h)) { prefactor(state, context, h); }
+			if (!valid) {
+				//Not positive definite (a zero mass node). The cloth keeps moving with the forces and the next step factorizes again
+				rows = columns = 0;
+				lastStats.fallbackSteps++;
+				context.forces(state.pos, state.vel, state.force);
+				integrateSymplecticEuler(path, state, dt, gravity);
+				return;
+			}
+
+			//Inertial prediction
+			copySoA(state.last, state.pos, state.capacity);
+			pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					glm::vec3 position = state.pos.get(i);
+					predicted[i] = state.invMass[i] > 0 ? position + h * state.vel.get(i) + h * h * state.invMass[i] * gravity : position;
+					current[i] = predicted[i];
+				}
+			});
+
+			const int freeCount = (int)freeNodes.size();
+			for (int iteration = 0; iteration < context.iterations; iteration++) {
+
+				//Local step
+				pool.parallelFor((int)springs.size(), springGrain, [&](int begin, int end) {
+					for (int s = begin; s < end; s++) {
+						glm::vec3 delta = current[springs[s].i] - current[springs[s].j];
+						float length = glm::length(delta);
+						projection[s] = length > 0 ? delta * (springs[s].restLength / length) : delta;
+					}
+				});
+
+				//Global step, the right side is built in the factor ordering
+				pool.parallelFor(freeCount, nodeGrain, [&](int begin, int end) {
+					for (int k = begin; k < end; k++) {
+						int i = freeNodes[k];
+						glm::dvec3 right = glm::dvec3(predicted[i]) / (double)(state.invMass[i] * h * h);
+						for (int p = adjacencyStart[i]; p < adjacencyStart[i + 1]; p++) {
+							const Spring &spring = springs[adjacency[p]];
+							glm::vec3 value = spring.i == i ? projection[adjacency[p]] : -projection[adjacency[p]];
+							int other = spring.i == i ? spring.j : spring.i;
+							if (state.invMass[other] <= 0) { value += current[other]; }
+							right += (double)context.Ke * glm::dvec3(value);
+						}
+						solution[k] = right;
+					}
+				});
+				cholesky.solve(solution.data());
+
+				pool.parallelFor(freeCount, nodeGrain, [&](int begin, int end) {
+					for (int k = begin; k < end; k++) { current[freeNodes[k]] = glm::vec3(solution[k]); }
+				});
+			}
+
+			pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					state.vel.set(i, (current[i] - state.last.get(i)) / h);
+					state.pos.set(i, current[i]);
+				}
+			});
+			lastStats.iterations = context.iterations;
+		}
+
+	private:
+		static const int nodeGrain = 2048;
+		static const int springGrain = 4096;
+
+		//What the factorization depends on. The rest length doesn't change the matrix
+		int rows = 0, columns = 0, springCount = 0;
+		float factorKe = 0, factorStep = 0;
+		std::vector<bool> fixed;
+		bool valid = false;
+
+		std::vector<int> freeNodes;     //Free nodes in the factor ordering
+		std::vector<int> adjacencyStart; //Springs of every node
+		std::vector<int> adjacency;
+
+		SparseCholesky cholesky;
+		std::vector<glm::vec3> predicted, current, projection;
+		std::vector<glm::dvec3> solution;
+		SolverStats lastStats;
+
+		bool factorizationValid(const ParticleState &state, const IntegrationContext &context, float h) const {
+
+			if (context.grid.rows != rows || context.grid.columns != columns || (int)context.springs->size() != springCount) { return false; }
+			if (context.Ke != factorKe || h != factorStep || (int)fixed.size() != state.count) { return false; }
+			for (int i = 0; i < state.count; i++) {
+				if (fixed[i] != (state.invMass[i] <= 0)) { return false; }
+			}
+			return true;
+		}
+
+		void prefactor(const ParticleState &state, const IntegrationContext &context, float h) {
+
+			const std::vector<Spring> &springs = *context.springs;
+			const int n = state.count;
+			rows = context.grid.rows;
+			columns = context.grid.columns;
+			springCount = (int)springs.size();
+			factorKe = context.Ke;
+			factorStep = h;
+			fixed.resize(n);
+			for (int i = 0; i < n; i++) { fixed[i] = state.invMass[i] <= 0; }
+
+			predicted.assign(n, glm::vec3(0, 0, 0));
+			current.assign(n, glm::vec3(0, 0, 0));
+			projection.assign(springs.size(), glm::vec3(0, 0, 0));
+
+			//Springs of every node
+			adjacencyStart.assign(n + 1, 0);
+			for (const Spring &spring : springs) {
+				adjacencyStart[spring.i + 1]++;
+				adjacencyStart[spring.j + 1]++;
+			}
+			for (int i = 0; i < n; i++) { adjacencyStart[i + 1] += adjacencyStart[i]; }
+			adjacency.resize(adjacencyStart[n]);
+			std::vector<int> next(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for (int s = 0; s < springCount; s++) {
+				adjacency[next[springs[s].i]++] = s;
+				adjacency[next[springs[s].j]++] = s;
+			}
+
+			//Fill-reducing ordering of the free nodes
+			std::vector<int> order;
+			order.reserve(n);
+			dissect(0, rows, 0, columns, context.grid, order);
+			freeNodes.clear();
+			std::vector<int> position(n, -1);
+			for (int i : order) {
+				if (fixed[i]) { continue; }
+				position[i] = (int)freeNodes.size();
+				freeNodes.push_back(i);
+			}
+			const int freeCount = (int)freeNodes.size();
+			solution.assign(freeCount, glm::dvec3(0, 0, 0));
+
+			//Upper triangle of the permuted matrix, by columns
+			std::vector<int> columnStart(freeCount + 1, 0), row;
+			std::vector<double> value;
+			for (int k = 0; k < freeCount; k++) {
+				int i = freeNodes[k];
+				int degree = adjacencyStart[i + 1] - adjacencyStart[i];
+				row.push_back(k);
+				value.push_back(1.0 / (state.invMass[i] * h * h) + (double)context.Ke * degree);
+				for (int p = adjacencyStart[i]; p < adjacencyStart[i + 1]; p++) {
+					const Spring &spring = springs[adjacency[p]];
+					int other = position[spring.i == i ? spring.j : spring.i];
+					if (other < 0 || other > k) { continue; }
+					row.push_back(other);
+					value.push_back(-(double)context.Ke);
+				}
+				columnStart[k + 1] = (int)row.size();
+			}
+
+			valid = cholesky.factor(freeCount, columnStart, row, value);
+			lastStats.factorizations++;
+			lastStats.factorNonZeros = cholesky.nonZeros();
+		}
+	};
+}
+
+std::unique_ptr<Integrator> createPDSolver() {
+
+	return std::unique_ptr<Integrator>(new ProjectiveDynamicsSolver());
+}
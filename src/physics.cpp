@@ -7,6 +7,11 @@
 #include <iostream>
 #include <time.h>
 #include <math.h>
+#include <vector>
+
+#include "cloth_simulation.h"
+#include "grid_kernels.h"
+#include "profiler.h"
 
 bool show_test_window = false;
 
@@ -16,308 +21,311 @@ namespace ClothMesh {
 	void updateClothMesh(float *array_data);
 	void drawClothMesh();
 };
+namespace Sphere {
+	void updateSphere(glm::vec3 pos, float radius);
+}
+namespace Capsule {
+	void updateCapsule(glm::vec3 posA, glm::vec3 posB, float radius);
+}
+extern bool renderSphere;
+extern bool renderCapsule;
+extern void GLcursorRay(float x, float y, glm::vec3 &origin, glm::vec3 &direction);
+
+//Cloth solver, the GUI edits its parameters
+ClothSimulation simulation;
+ClothParams &params = simulation.params;
 
 //Mesh variables
-const int meshRows = 18;
-const int meshColumns = 14;
-const int totalVertex = meshRows * meshColumns;
-
-static int Ke = 100; //Stiffness
-static float Kd = 0.5; //Damping
-static float L = 0.3f;
-static float elasticity = 0.8f;
-static int maxElongation = 50;
+ClothGrid clothGrid = { 18, 14 };
+static int meshRows = 18;
+static int meshColumns = 14;
+
 static int resetTime = 10;
 static float dtCounter = 0;
-static float height = 9.9f;
-
-static int lastKe, lastElongation;
-static float lastKd, lastL,lastTime;
-
-float distanceRight = 0;
-float distanceDown = 0;
-glm::vec3 unitariRight;
-glm::vec3 unitariDown;
-float difference = 0;
-float maxL = L + (L * maxElongation) / 100;
-
-//Mesh arrays
-glm::vec3 *nodeVectors;
-glm::vec3 *lastVectors;
-glm::vec3 *velVectors;
-glm::vec3 *newVectors;
-glm::vec3 *forceVectors;
-
-//Cube planes
-glm::vec3 groundN = { 0,1,0 };
-glm::vec3 roofN = { 0,-1,0 };
-glm::vec3 leftN = { 1,0,0 };
-glm::vec3 rightN = { -1,0,0 };
-glm::vec3 backN = { 0,0,1 };
-glm::vec3 frontN = { 0,0,-1 };
+
+//Interleaved positions uploaded to the cloth mesh, for the last two steps
+std::vector<float> renderVectors;
+std::vector<float> previousVectors;
+std::vector<float> interpolatedVectors;
+
+//Fixed timestep, the frame time is accumulated and consumed in steps of 1 / physicsRate
+static int physicsRate = 60; //Steps per second
+static int maxFrameSteps = 64; //Catch-up limit, the rest of a slow frame is dropped
+static bool interpolateRender = true; //Render between the last two steps
+static double accumulator = 0;
+static int frameSteps = 0;
+static bool restarted = false; //The state jumped, there is nothing to interpolate from
+
+static float simdDifference = -1;
+static int pickedNode = -1; //Node under the mouse on the last click or drag, picked on the BVH
+
+//Colliders of the sphere and capsule primitives, placed as render_prims sets them up. Both can oscillate
+static int sphereIndex, capsuleIndex;
+
+static char profileCsvPath[256] = "profile.csv";
+static char tracePath[256] = "trace.json"; //Written by the button, or at exit while recording
+
+void profilerPanel() {
+
+	//Rolling statistics and the last samples of every timer, PROFILE_SCOPE records nothing without CLOTH_PROFILING
+#ifdef CLOTH_PROFILING
+	Profiler &profiler = Profiler::instance();
+	for (int t = 0; t < profiler.timerCount(); t++) {
+		ProfileStats stats = profiler.stats(t);
+		int count, offset;
+		const float *history = profiler.history(t, count, offset);
+		char overlay[96];
+		snprintf(overlay, sizeof(overlay), "min %.3f avg %.3f p99 %.3f ms", stats.min, stats.avg, stats.p99);
+		ImGui::PlotLines(profiler.name(t), history, count, offset, overlay, 0.f, FLT_MAX, ImVec2(0, 40));
+	}
+	ImGui::InputText("CSV file", profileCsvPath, sizeof(profileCsvPath));
+	if (!profiler.csvOpen()) {
+		if (ImGui::Button("Start CSV")) { profiler.startCsv(profileCsvPath); }
+	}
+	else if (ImGui::Button("Stop CSV")) { profiler.stopCsv(); }
+	Tracer &tracer = Tracer::instance();
+	ImGui::InputText("Trace file", tracePath, sizeof(tracePath));
+	if (!tracer.recording()) {
+		if (ImGui::Button("Record trace")) { tracer.start(); }
+	}
+	else if (ImGui::Button("Write trace")) { tracer.write(tracePath); }
+#else
+	ImGui::Text("Built without CLOTH_PROFILING (Debug configurations define it)");
+#endif
+}
 
 void GUI() {
 
 	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 	ImGui::SliderInt("Reset Time", &resetTime, 0, 20);
-	ImGui::SliderInt("Ke", &Ke, 100, 2000);
-	ImGui::SliderFloat("Kd", &Kd, 0.1f, 100);
-	ImGui::SliderInt("Max elongation (%)", &maxElongation, 1, 300);
-	ImGui::SliderFloat("Inital rest distance", &L, 0.1f, 0.75f);
-	ImGui::SliderFloat("Elasticity", &elasticity, 0.1f, 0.9f);
-	ImGui::SliderFloat("Mesh height", &height, 0.1f, 9.9f);
-
-	if (show_test_window) {
-		ImGui::SetNextWindowPos(ImVec2(650, 20), ImGuiSetCond_FirstUseEver);
-		ImGui::ShowTestWindow(&show_test_window);
+	ImGui::SliderInt("Physics rate (Hz)", &physicsRate, 30, 2000);
+	ImGui::SliderInt("Max steps per frame", &maxFrameSteps, 1, 256);
+	ImGui::Checkbox("Interpolate render", &interpolateRender);
+	ImGui::SameLine();
+	ImGui::Text("%d steps last frame", frameSteps);
+	ImGui::SliderInt("Ke", &params.Ke, 100, 2000);
+	ImGui::SliderFloat("Kd", &params.Kd, 0.1f, 100);
+	ImGui::SliderInt("Max elongation (%)", &params.maxElongation, 1, 300);
+	ImGui::SliderFloat("Inital rest distance", &params.L, 0.1f, 0.75f);
+	ImGui::SliderFloat("Mesh height", &params.height, 0.1f, 9.9f);
+	ImGui::SliderInt("Mesh rows", &meshRows, minClothSide, maxClothSide);
+	ImGui::SliderInt("Mesh columns", &meshColumns, minClothSide, maxClothSide);
+	ImGui::SliderInt("Strain iterations", &params.strainIterations, 0, 250);
+	ImGui::SliderFloat("Strain tolerance", &params.strainTolerance, 0.f, 0.5f);
+	int strainOrdering = (int)params.strainOrdering;
+	if (ImGui::Combo("Strain ordering", &strainOrdering, "Jacobi\0Gauss-Seidel\0")) { params.strainOrdering = (StrainOrdering)strainOrdering; }
+	int integratorType = (int)params.integrator;
+	if (ImGui::Combo("Integrator", &integratorType, "Explicit Euler\0Symplectic Euler\0Verlet\0RK4\0Implicit Euler\0XPBD\0Projective Dynamics\0")) { params.integrator = (IntegratorType)integratorType; }
+	int precision = (int)params.precision;
+	if (ImGui::Combo("Precision", &precision, "Float\0Mixed\0Double\0")) { params.precision = (Precision)precision; }
+	if (simulation.activePrecision() != params.precision) { ImGui::Text("%s runs in %s precision", integratorName(params.integrator), precisionName(simulation.activePrecision())); }
+	const Integrator *integrator = simulation.integrator.get();
+	if (params.integrator == IntegratorType::ImplicitEuler) {
+		ImGui::SliderFloat("CG tolerance", &params.solverTolerance, 1e-6f, 1e-1f, "%.6f", 10.f);
+		ImGui::SliderInt("CG max iterations", &params.solverIterations, 1, 500);
+		ImGui::Checkbox("CG warm start", &params.solverWarmStart);
+		if (integrator) { ImGui::Text("CG %d iterations, residual %g", integrator->stats().iterations, integrator->stats().residual); }
 	}
-}
-
-float calculateCollision(glm::vec3 vector, glm::vec3 lastvector, glm::vec3 normal, int d) {
-
-	float calc1 = glm::dot(vector, normal) + d;
-	float calc2 = glm::dot(lastvector, normal) + d;
-	return calc1*calc2;
-
-}
-
-void calculateAllCollisions(glm::vec3 &vectorPos, glm::vec3 &vectorsVel, glm::vec3 &lastPosition) {
-
-	if (calculateCollision(vectorPos, lastPosition, groundN, 0) < 0) { //Collision with ground
-		vectorPos = vectorPos - (1 + elasticity) * (glm::dot(groundN, vectorPos) + 0) * groundN; 
-		vectorsVel = vectorsVel - (1 + elasticity) * (glm::dot(groundN, vectorsVel) + 0) * groundN;
+	if (params.integrator == IntegratorType::XPBD) {
+		ImGui::SliderInt("Substeps", &params.solverSubsteps, 1, 50);
+		ImGui::SliderInt("Constraint iterations", &params.constraintIterations, 1, 50);
 	}
-
-	if (calculateCollision(vectorPos, lastPosition, roofN, 10) <= 0) { //Collision with roof
-		vectorPos = vectorPos - (1 + elasticity) * (glm::dot(roofN, vectorPos) + 10) * roofN; 
-		vectorsVel = vectorsVel - (1 + elasticity) * (glm::dot(roofN, vectorsVel) + 0) * roofN; 
+	if (params.integrator == IntegratorType::ProjectiveDynamics) {
+		ImGui::SliderInt("Local/global iterations", &params.constraintIterations, 1, 50);
+		if (integrator) {
+			const SolverStats stats = integrator->stats();
+			ImGui::Text("%d factorizations, %d factor non-zeros", stats.factorizations, (int)stats.factorNonZeros);
+			if (stats.fallbackSteps > 0) { ImGui::Text("Factorization failed, %d steps with symplectic Euler", stats.fallbackSteps); }
+		}
 	}
-
-	if (calculateCollision(vectorPos, lastPosition, leftN, 5) <= 0) { //Collision with left wall
-		vectorPos = vectorPos - (1 + elasticity) * (glm::dot(leftN, vectorPos) + 5) * leftN; 
-		vectorsVel = vectorsVel - (1 + elasticity) * (glm::dot(leftN, vectorsVel) + 0) * leftN; 
+	ImGui::SliderInt("Physics threads", &params.threads, 1, glm::max(1, (int)std::thread::hardware_concurrency()));
+	ImGui::Checkbox("SIMD kernels", &params.useSimd);
+	ImGui::SameLine();
+	ImGui::Text("(%s)", kernelPathName(bestKernelPath()));
+	ImGui::Checkbox("Grid kernels", &params.gridKernels);
+	if (params.gridKernels) {
+		bool specialized = false;
+		gridForceKernel(simulation.kernelPath(), simulation.grid, &specialized);
+		ImGui::SameLine();
+		ImGui::Text(specialized ? "(%dx%d specialized)" : "(%dx%d runtime size)", simulation.grid.rows, simulation.grid.columns);
 	}
-
-	if (calculateCollision(vectorPos, lastPosition, rightN, 5) <= 0) { //Collision with right wall
-		vectorPos = vectorPos - (1 + elasticity) * (glm::dot(rightN, vectorPos) + 5) * rightN; 
-		vectorsVel = vectorsVel - (1 + elasticity) * (glm::dot(rightN, vectorsVel) + 0) * rightN; 
+	if (ImGui::Button("Compare SIMD with scalar")) { simdDifference = simulation.compareKernels(); }
+	if (simdDifference >= 0) { ImGui::SameLine(); ImGui::Text("Max force difference %g", simdDifference); }
+	ImGui::Checkbox("Continuous collisions", &params.continuousCollisions);
+	ImGui::Checkbox("Self-collision", &params.selfCollision);
+	if (params.selfCollision) {
+		ImGui::SliderFloat("Thickness", &params.selfThickness, 0.01f, 0.3f);
+		const SelfCollisionStats &stats = simulation.selfCollision.stats();
+		int broadphase = (int)params.selfBroadphase;
+		if (ImGui::Combo("Broadphase", &broadphase, "Spatial hash\0BVH\0")) { params.selfBroadphase = (SelfCollisionBroadphase)broadphase; }
+		ImGui::Text("%lld pairs tested, %d contacts (%d continuous)", stats.pairsTested, stats.contacts, stats.impacts);
 	}
-
-	if (calculateCollision(vectorPos, lastPosition, frontN, 5) <= 0) { //Collision with front wall
-		vectorPos = vectorPos - (1 + elasticity) * (glm::dot(frontN, vectorPos) + 5) * frontN; 
-		vectorsVel = vectorsVel - (1 + elasticity) * (glm::dot(frontN, vectorsVel) + 0) * frontN; 
+	const ClothBVHStats &tree = simulation.bvh.stats();
+	ImGui::Text("BVH %d nodes, depth %d, cost %.2f (%.2f after the build), %d rebuilds", tree.nodes, tree.depth, tree.cost, tree.buildCost, tree.rebuilds);
+	//Picking refits the BVH, so only on a click or while dragging with the mouse moving
+	const ImGuiIO &io = ImGui::GetIO();
+	bool dragged = ImGui::IsMouseDragging(0) && (io.MouseDelta.x != 0 || io.MouseDelta.y != 0);
+	if (!io.WantCaptureMouse && (ImGui::IsMouseClicked(0) || dragged)) {
+		glm::vec3 origin, direction;
+		GLcursorRay(io.MousePos.x, io.MousePos.y, origin, direction);
+		pickedNode = simulation.pickNode(origin, direction);
 	}
-
-	if (calculateCollision(vectorPos, lastPosition, backN, 5) <= 0) { //Collision with back wall
-		vectorPos = vectorPos - (1 + elasticity) * (glm::dot(backN, vectorPos) + 5) * backN; 
-		vectorsVel = vectorsVel - (1 + elasticity) * (glm::dot(backN, vectorsVel) + 0) * backN; 
+	if (pickedNode >= 0) { ImGui::Text("Picked node %d (row %d, column %d)", pickedNode, pickedNode / simulation.grid.columns, pickedNode % simulation.grid.columns); }
+	if (ImGui::TreeNode("Colliders")) {
+		for (size_t i = 0; i < simulation.colliders.size(); i++) {
+			Collider &collider = simulation.colliders[i];
+			ImGui::PushID((int)i);
+			ImGui::Checkbox(colliderTypeName(collider.type), &collider.enabled);
+			ImGui::SliderFloat("Elasticity", &collider.elasticity, 0.1f, 0.9f);
+			ImGui::SliderFloat("Friction", &collider.friction, 0.f, 1.f);
+			for (ColliderAnimation &animation : simulation.animations) {
+				if (animation.collider != (int)i) { continue; }
+				ImGui::SliderFloat("Radius", &collider.radius, 0.1f, 3.f);
+				ImGui::DragFloat3("Position", &animation.center.x, 0.05f);
+				if (collider.type == ColliderType::Capsule) { ImGui::DragFloat3("End", &animation.end.x, 0.05f); }
+				ImGui::DragFloat3("Motion amplitude", &animation.amplitude.x, 0.05f);
+				ImGui::SliderFloat("Motion frequency (Hz)", &animation.frequency, 0.f, 2.f);
+			}
+			ImGui::PopID();
+		}
+		ImGui::TreePop();
+	}
+	const StepTimings &timings = simulation.timings;
+	ImGui::Text("Forces %.3f ms, integration %.3f ms", timings.forces, timings.integration);
+	ImGui::Text("Strain limiting %.3f ms (%d sweeps), self-collision %.3f ms, collisions %.3f ms", timings.strain, simulation.strainSweeps, timings.selfCollision, timings.collisions);
+	if (ImGui::TreeNode("Profiler")) {
+		profilerPanel();
+		ImGui::TreePop();
 	}
-}
-
-
-glm::vec3 calculateForces(glm::vec3 P1, glm::vec3 P2, glm::vec3 v1, glm::vec3 v2, float Length) {
-
-	float distance = glm::length(P1 - P2); //Calculate distance between points 
-
-	glm::vec3 velocity = (v1 - v2); //Velocity vector
-
-	glm::vec3 normalVector = glm::normalize(P1 - P2); //Normal vector
-
-	float Calc1 = Ke*(distance - Length) + glm::dot(Kd*velocity, normalVector); //First calculus of force
-
-	glm::vec3 totalResult = (-Calc1) *normalVector; //Final force vector
-
-	return totalResult;
 
+	if (show_test_window) {
+		ImGui::SetNextWindowPos(ImVec2(650, 20), ImGuiSetCond_FirstUseEver);
+		ImGui::ShowTestWindow(&show_test_window);
+	}
 }
 
-glm::vec3 calculateAllForces(glm::vec3 vectorsPos[], glm::vec3 vectorsVel[], int calcVector) {
-
-	glm::vec3 totalForces;
-
-	//Structural
-	if (calcVector % 14 != 13) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector + 1], vectorsVel[calcVector], vectorsVel[calcVector + 1], L); } //Dreta 
-
-	if (calcVector % 14 != 0) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector - 1], vectorsVel[calcVector], vectorsVel[calcVector - 1], L); }//Esquerra
-
-	if (calcVector / 14 != 0) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector - 14], vectorsVel[calcVector], vectorsVel[calcVector - 14], L); } //Adalt
-
-	if (calcVector / 14 != 17) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector + 14], vectorsVel[calcVector], vectorsVel[calcVector + 14], L); } //Abaix
-
-	//Shear
-	if (calcVector % 14 != 13 && calcVector / 14 != 0) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector - 13], vectorsVel[calcVector], vectorsVel[calcVector - 13], sqrt(L*L + L*L)); } //Diagonal dreta adalt
-
-	if (calcVector % 14 != 13 && calcVector / 14 != 17) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector + 15], vectorsVel[calcVector], vectorsVel[calcVector + 15], sqrt(L*L + L*L)); } //Diagonal dreta abaix
-
-	if (calcVector % 14 != 0 && calcVector / 14 != 0) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector - 15], vectorsVel[calcVector], vectorsVel[calcVector - 15], sqrt(L*L + L*L)); } //Diagonal esquerra adalt
-
-	if (calcVector % 14 != 0 && calcVector / 14 != 17) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector + 13], vectorsVel[calcVector], vectorsVel[calcVector + 13], sqrt(L*L + L*L)); } //Diagonal esquerra abaix
-
-	//Bending
-	if (calcVector % 14 != 13 && calcVector % 14 != 12) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector + 2], vectorsVel[calcVector], vectorsVel[calcVector + 2], L * 2); } //Doble dreta
-
-	if (calcVector % 14 != 0 && calcVector % 14 != 1) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector - 2], vectorsVel[calcVector], vectorsVel[calcVector - 2], L * 2); } //Doble esquerra
-
-	if (calcVector / 14 != 0 && calcVector / 14 != 1) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector - 28], vectorsVel[calcVector], vectorsVel[calcVector - 28], L * 2); } //Doble adalt
-
-	if (calcVector / 14 != 17 && calcVector / 14 != 16) { totalForces += calculateForces(vectorsPos[calcVector], vectorsPos[calcVector + 28], vectorsVel[calcVector], vectorsVel[calcVector + 28], L * 2); } //Doble abaix
-
-	return totalForces;
+void reset() {
 
+	simulation.reset();
+	restarted = true;
 }
 
-void reset() {
+void allocateMesh() {
 
-	//Function that resets to the beggining all the positions, forces and velocites of the mesh
-	int columnsCounter = 0;
-	int rowsCounter = 0;
-
-	for (int i = 0; i < totalVertex; i++) {
-		nodeVectors[i] = { L * columnsCounter - (L*meshColumns / 2) + L / 2,height, L * rowsCounter - (L*meshRows / 2) + L / 2 };
-		velVectors[i] = { 0,0,0 };
-		newVectors[i] = nodeVectors[i];
-		forceVectors[i] = { 0,0,0 };
-		if (columnsCounter >= 13) {
-			columnsCounter = 0;
-			rowsCounter += 1;
-		}
-		else { columnsCounter += 1; }
-	}
+	//Creation of the node arrays for the current grid
+	simulation.allocate(clothGrid);
+	renderVectors.resize(3 * clothGrid.totalVertex());
+	previousVectors.resize(3 * clothGrid.totalVertex());
+	interpolatedVectors.resize(3 * clothGrid.totalVertex());
+	pickedNode = -1;
+	restarted = true;
 }
 
 void checkChanges() {
 
-	//Check for changes on variables to reset the Mesh
-	if (lastKe != Ke || lastKd != Kd || lastElongation != maxElongation || lastL != L || lastTime != resetTime) {
-		lastKe = Ke;
-		lastKd = Kd;
-		lastElongation = maxElongation;
-		lastL = L;
-		lastTime = resetTime;
-		reset();
+	//Check for changes on the grid size to rebuild the Mesh
+	if (meshRows != clothGrid.rows || meshColumns != clothGrid.columns) {
+		clothGrid = { meshRows, meshColumns };
+		allocateMesh();
+		dtCounter = 0;
 	}
 }
 
-void checkElongation(glm::vec3 posVectors[]) {
-
-	maxL = L + (L * maxElongation) / 100; //Calculate the max elongation with %
+void setupColliders() {
 
-	for (int i = 0; i < totalVertex; i++) {
-		
-		if (i % 14 != 13) { //Check if there's a node on the right
+	//Static until the GUI gives them a motion amplitude
+	std::vector<Collider> &colliders = simulation.colliders;
+	sphereIndex = (int)colliders.size();
+	colliders.push_back(sphereCollider({ 0.f, 1.f, 0.f }, 1.f, 0.5f, 0.3f));
+	colliders.back().enabled = renderSphere;
+	capsuleIndex = (int)colliders.size();
+	colliders.push_back(capsuleCollider({ -3.f, 2.f, -2.f }, { -4.f, 2.f, 2.f }, 1.f, 0.5f, 0.3f));
+	colliders.back().enabled = renderCapsule;
 
-			distanceRight = glm::length(posVectors[i] - posVectors[i + 1]); //Calculate distance with vectors
-			unitariRight = glm::normalize(posVectors[i] - posVectors[i + 1]); //Calculate normal vector
-
-			if (distanceRight > maxL) { //Check if the distance is higher than the max
-				difference = maxL - distanceRight;
-				if (i != 0) { posVectors[i] += (difference / 2) * unitariRight; }
-				if (i != 12) { posVectors[i + 1] -= (difference / 2) * unitariRight; }
-			}
-		}
-
-		if (i / 14 != 17) { //Check if there's a node down
-			
-			distanceDown = glm::length(posVectors[i] - posVectors[i + 14]);
-			unitariDown = glm::normalize(posVectors[i] - posVectors[i + 14]);
-
-			if (distanceDown > maxL) { //Check if the distance is higher than the max
-				difference = maxL - distanceDown;
-				if (i == 0 || i == 13) {}
-				else { posVectors[i] += (difference / 2) * unitariDown; }
-				posVectors[i + 14] -= (difference / 2) * unitariDown;
-			}
-		}
+	for (int i : { sphereIndex, capsuleIndex }) {
+		ColliderAnimation animation = { i, colliders[i].center, colliders[i].end, { 0, 0, 0 }, 0.5f };
+		simulation.animations.push_back(animation);
 	}
 }
 
-void PhysicsInit() {
+void updatePrimitives() {
 
-	//Creation of all glm::vec3 arrays
-	nodeVectors = new glm::vec3[totalVertex];
-	velVectors = new glm::vec3[totalVertex];
-	newVectors = new glm::vec3[totalVertex];
-	forceVectors = new glm::vec3[totalVertex];
-	lastVectors = new glm::vec3[totalVertex];
-
-	//Declaration of mesh counters
-	int columnsCounter = 0;
-	int rowsCounter = 0;
-
-	//Applying values to "last" variables for reseting
-	lastKe = Ke;
-	lastKd = Kd;
-	lastElongation = maxElongation;
-	lastL = L;
-	lastTime = resetTime;
-
-	//For that creates the Mesh with an "L" separation
-	for (int i = 0; i < totalVertex; i++) {
-		nodeVectors[i] = { L * columnsCounter - (L*meshColumns / 2) + L / 2,height, L * rowsCounter - (L*meshRows / 2) + L / 2 };
-		velVectors[i] = { 0,0,0 };
-		newVectors[i] = nodeVectors[i];
-		forceVectors[i] = { 0,0,0 };
-		if (columnsCounter >= 13) {
-			columnsCounter = 0;
-			rowsCounter += 1;
-		}
-		else { columnsCounter += 1; }
-	}
+	//The sphere and the capsule are drawn where they collide
+	const Collider &sphere = simulation.colliders[sphereIndex];
+	const Collider &capsule = simulation.colliders[capsuleIndex];
+	TRACE_SCOPE("Primitive upload");
+	renderSphere = sphere.enabled;
+	renderCapsule = capsule.enabled;
+	Sphere::updateSphere(sphere.center, sphere.radius);
+	Capsule::updateCapsule(capsule.center, capsule.end, capsule.radius);
 }
 
+void PhysicsInit() {
 
-void PhysicsUpdate(float dt) {
-
-	//Top left always the same positions
-	nodeVectors[0] = { L * 0 - (L*meshColumns / 2) + L / 2,height, L * 0 - (L*meshRows / 2) + L / 2 };
-
-	//Top right always the same positions
-	nodeVectors[13] = { L * 13 - (L*meshColumns / 2) + L / 2,height, L * 0 - (L*meshRows / 2) + L / 2 };
-
-	for (int i = 0; i < totalVertex; i++) { //Applying forces and velocities on all nodes
-
-		if (i == 0 || i == 13) { forceVectors[i] = { 0,0,0 }; }
-		else {
-			forceVectors[i] = calculateAllForces(nodeVectors, velVectors, i); //Calculate forces and store them on array
-		}
-	}
-
-	for (int i = 0; i < totalVertex; i++) { //Applying Euler's solver and upating
+	setupColliders();
 
-		if (i == 0 || i == 13) { forceVectors[i] = { 0,0,0 }; }
-		else {
+	//Creation of all node arrays, with the Mesh with an "L" separation
+	clothGrid = { meshRows, meshColumns };
+	allocateMesh();
+}
 
-		lastVectors[i] = nodeVectors[i]; //Store last position vector
+void stepSimulation(float dt) {
 
-		//Velocities and gravity
-		velVectors[i].x = velVectors[i].x + dt * forceVectors[i].x;
-		velVectors[i].y = velVectors[i].y + dt * (-9.81f + forceVectors[i].y);
-		velVectors[i].z = velVectors[i].z + dt * forceVectors[i].z;
+	simulation.step(dt);
 
-		forceVectors[i] = glm::vec3(0, 0, 0); //Reset forces
-		
-		newVectors[i] = nodeVectors[i] + dt * velVectors[i]; //Euler 
+	dtCounter += dt;
 
-		nodeVectors[i] = newVectors[i]; //Update position
+	checkChanges(); //Check if the grid size has changed, to rebuild. Other parameters are applied on the fly by the simulation
 
-		checkElongation(nodeVectors); //Check max elongation
+	if (dtCounter >= resetTime) { reset(); dtCounter = 0; } //Reset every "x" seconds
+}
 
-		calculateAllCollisions(nodeVectors[i], velVectors[i], lastVectors[i]); //Calculate particle collision
-		
-		}
+void PhysicsUpdate(float frameTime) {
+
+	PROFILE_SCOPE("Physics");
+	//Fixed steps for the elapsed time, independent of the frame rate
+	const double fixedStep = 1.0 / physicsRate;
+	accumulator += frameTime;
+	frameSteps = 0;
+	while (accumulator >= fixedStep && frameSteps < maxFrameSteps) {
+		std::swap(previousVectors, renderVectors);
+		stepSimulation((float)fixedStep);
+		simulation.nodes.packPositions(renderVectors.data());
+		if (restarted) { previousVectors = renderVectors; restarted = false; }
+		accumulator -= fixedStep;
+		frameSteps++;
 	}
+	if (frameSteps == maxFrameSteps) { accumulator = glm::min(accumulator, fixedStep); } //Too far behind, drop the rest
 
-	dtCounter += dt;
+	if (restarted) { //Changed outside a step
+		simulation.nodes.packPositions(renderVectors.data());
+		previousVectors = renderVectors;
+		restarted = false;
+	}
 
-	checkChanges(); //Check if variables have changed, to reset
+	updatePrimitives();
 
-	if (dtCounter >= resetTime) { reset(); dtCounter = 0; } //Reset every "x" seconds
+	//The rendered state lags one step, at "alpha" between the last two steps
+	if (!interpolateRender) {
+		PROFILE_SCOPE("Mesh upload");
+		ClothMesh::updateClothMesh(renderVectors.data());
+		return;
+	}
+	float alpha = (float)(accumulator / fixedStep);
+	for (size_t i = 0; i < renderVectors.size(); i++) {
+		interpolatedVectors[i] = previousVectors[i] + alpha * (renderVectors[i] - previousVectors[i]);
+	}
+	PROFILE_SCOPE("Mesh upload");
+	ClothMesh::updateClothMesh(interpolatedVectors.data());
+}
 
-	ClothMesh::updateClothMesh(&nodeVectors[0].x);
+void PhysicsSetIntegrator(IntegratorType type) {
 
+	params.integrator = type;
 }
 
-
 void PhysicsCleanup() {
 
-}
\ No newline at end of file
+	if (Tracer::instance().recording()) { Tracer::instance().write(tracePath); }
+	simulation.release();
+}
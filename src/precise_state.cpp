@@ -0,0 +1,112 @@
+#include <cstring>
+
+#include "precise_state.h"
+
+const char *precisionName(Precision precision) {
+	switch (precision) {
+	case Precision::Mixed: return "Mixed";
+	case Precision::Double: return "Double";
+	default: return "Float";
+	}
+}
+
+const char *precisionOption(Precision precision) {
+	switch (precision) {
+	case Precision::Mixed: return "mixed";
+	case Precision::Double: return "double";
+	default: return "float";
+	}
+}
+
+bool parsePrecisionOption(const char *option, Precision &precision) {
+
+	for (int i = 0; i < precisionCount; i++) {
+		if (strcmp(option, precisionOption((Precision)i)) == 0) {
+			precision = (Precision)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+namespace {
+
+	void loadArray(double *precise, const float *rounded, int capacity) {
+
+		for (int i = 0; i < capacity; i++) { precise[i] = rounded[i]; }
+	}
+
+	void roundArray(float *rounded, const double *precise, int capacity) {
+
+		for (int i = 0; i < capacity; i++) { rounded[i] = (float)precise[i]; }
+	}
+
+	//A float value that isn't the rounding of its double one was changed by a float stage, by the difference of both
+	void syncArray(double *precise, float *rounded, int capacity) {
+
+		for (int i = 0; i < capacity; i++) {
+			float current = (float)precise[i];
+			if (rounded[i] != current) {
+				precise[i] += (double)rounded[i] - (double)current;
+				rounded[i] = (float)precise[i];
+			}
+		}
+	}
+}
+
+void PreciseState::load(const ParticleState &state) {
+
+	capacity = state.capacity;
+	arena.reserve(9, capacity);
+	pos = arena.soa(0, capacity);
+	vel = arena.soa(3, capacity);
+	force = arena.soa(6, capacity);
+	loadArray(pos.x, state.pos.x, capacity); loadArray(pos.y, state.pos.y, capacity); loadArray(pos.z, state.pos.z, capacity);
+	loadArray(vel.x, state.vel.x, capacity); loadArray(vel.y, state.vel.y, capacity); loadArray(vel.z, state.vel.z, capacity);
+}
+
+void PreciseState::release() {
+
+	arena.release();
+	pos = vel = force = {};
+	capacity = 0;
+}
+
+void PreciseState::sync(ParticleState &state, bool velocities) {
+
+	syncArray(pos.x, state.pos.x, capacity); syncArray(pos.y, state.pos.y, capacity); syncArray(pos.z, state.pos.z, capacity);
+	if (velocities) { syncArray(vel.x, state.vel.x, capacity); syncArray(vel.y, state.vel.y, capacity); syncArray(vel.z, state.vel.z, capacity); }
+}
+
+void PreciseState::round(ParticleState &state, bool velocities) const {
+
+	roundArray(state.pos.x, pos.x, capacity); roundArray(state.pos.y, pos.y, capacity); roundArray(state.pos.z, pos.z, capacity);
+	if (velocities) { roundArray(state.vel.x, vel.x, capacity); roundArray(state.vel.y, vel.y, capacity); roundArray(state.vel.z, vel.z, capacity); }
+}
+
+void PreciseState::advancePositions(ParticleState &state, float dt) {
+
+	const double step = dt;
+	for (int i = 0; i < capacity; i++) {
+		pos.x[i] += step * state.vel.x[i];
+		pos.y[i] += step * state.vel.y[i];
+		pos.z[i] += step * state.vel.z[i];
+	}
+	round(state, false);
+}
+
+void PreciseState::integrateSymplecticEuler(ParticleState &state, float dt, glm::vec3 gravity) {
+
+	copySoA(state.last, state.pos, capacity);
+	const double step = dt;
+	for (int i = 0; i < capacity; i++) {
+		double w = state.invMass[i];
+		vel.x[i] += step * (w * (force.x[i] + gravity.x));
+		vel.y[i] += step * (w * (force.y[i] + gravity.y));
+		vel.z[i] += step * (w * (force.z[i] + gravity.z));
+		pos.x[i] += step * vel.x[i];
+		pos.y[i] += step * vel.y[i];
+		pos.z[i] += step * vel.z[i];
+	}
+	round(state, true);
+}
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <vector>
+
+#include "profiler.h"
+
+Profiler &Profiler::instance() {
+
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::~Profiler() {
+
+	stopCsv();
+}
+
+int Profiler::timer(const char *name) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int t = 0; t < timers; t++) {
+		if (list[t].name == name) { return t; }
+	}
+	if (timers == maxProfileTimers) { return maxProfileTimers - 1; } //Shared by the extra ones
+	list[timers].name = name;
+	return timers++;
+}
+
+void Profiler::add(int timer, float ms) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Timer &t = list[timer];
+	t.samples[t.next] = ms;
+	t.next = (t.next + 1) % profileWindow;
+	t.count = std::min(t.count + 1, profileWindow);
+	t.frameMs += ms;
+	t.frameCalls++;
+}
+
+void Profiler::endFrame() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (csv) {
+		//The header goes with the first row, when the stages of a frame have made their timers
+		if (csvColumns == 0) {
+			csvColumns = timers;
+			fprintf(csv, "frame");
+			for (int t = 0; t < csvColumns; t++) { fprintf(csv, ",%s ms,%s calls", list[t].name.c_str(), list[t].name.c_str()); }
+			fprintf(csv, "\n");
+		}
+		fprintf(csv, "%lld", frame);
+		for (int t = 0; t < csvColumns; t++) { fprintf(csv, ",%.4f,%d", list[t].frameMs, list[t].frameCalls); }
+		fprintf(csv, "\n");
+	}
+	for (int t = 0; t < timers; t++) {
+		list[t].frameMs = 0;
+		list[t].frameCalls = 0;
+	}
+	frame++;
+}
+
+bool Profiler::startCsv(const char *path) {
+
+	stopCsv();
+	csv = fopen(path, "w");
+	csvColumns = 0;
+	return csv != nullptr;
+}
+
+void Profiler::stopCsv() {
+
+	if (csv) { fclose(csv); }
+	csv = nullptr;
+}
+
+ProfileStats Profiler::stats(int timer) const {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	ProfileStats stats;
+	const Timer &t = list[timer];
+	if (t.count == 0) { return stats; }
+
+	std::vector<float> sorted(t.samples, t.samples + t.count);
+	stats.last = t.samples[(t.next + profileWindow - 1) % profileWindow];
+	stats.samples = t.count;
+	stats.min = *std::min_element(sorted.begin(), sorted.end());
+	double sum = 0;
+	for (float ms : sorted) { sum += ms; }
+	stats.avg = (float)(sum / t.count);
+	int rank = std::min(t.count - 1, (int)(0.99f * t.count));
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	stats.p99 = sorted[rank];
+	return stats;
+}
+
+const float *Profiler::history(int timer, int &count, int &offset) const {
+
+	const Timer &t = list[timer];
+	count = t.count;
+	offset = t.count < profileWindow ? 0 : t.next;
+	return t.samples;
+}
+
+namespace {
+
+	//Buffer of the thread, handed back to the Tracer when the thread exits
+	struct ThreadTrace {
+		TraceBuffer *buffer = nullptr;
+		const char *scope = nullptr;
+		~ThreadTrace() { if (buffer) { buffer->inUse = false; } }
+	};
+
+	thread_local ThreadTrace threadTrace;
+
+	long long sinceEpoch(std::chrono::high_resolution_clock::time_point epoch, std::chrono::high_resolution_clock::time_point time) {
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch).count();
+	}
+}
+
+Tracer &Tracer::instance() {
+
+	static Tracer tracer;
+	return tracer;
+}
+
+TraceBuffer *Tracer::threadBuffer() {
+
+	if (threadTrace.buffer) { return threadTrace.buffer; }
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::unique_ptr<TraceBuffer> &buffer : buffers) {
+		bool expected = false;
+		if (buffer->inUse.compare_exchange_strong(expected, true)) {
+			//The events of the thread that left it are dropped, a track only has the events of one thread
+			buffer->written.store(0, std::memory_order_release);
+			threadTrace.buffer = buffer.get();
+			break;
+		}
+	}
+	if (!threadTrace.buffer) {
+		buffers.emplace_back(new TraceBuffer());
+		threadTrace.buffer = buffers.back().get();
+		threadTrace.buffer->id = (int)buffers.size();
+	}
+	threadTrace.buffer->name = "Thread " + std::to_string(threadTrace.buffer->id);
+	return threadTrace.buffer;
+}
+
+void Tracer::start() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::unique_ptr<TraceBuffer> &buffer : buffers) { buffer->written = 0; }
+	active = true;
+}
+
+void Tracer::stop() {
+
+	active = false;
+}
+
+void Tracer::record(const char *name, std::chrono::high_resolution_clock::time_point begin, std::chrono::high_resolution_clock::time_point end) {
+
+	TraceBuffer *buffer = threadBuffer();
+	long long index = buffer->written.load(std::memory_order_relaxed);
+	TraceEvent &event = buffer->events[index % traceBufferEvents];
+	event.name = name;
+	event.begin = sinceEpoch(epoch, begin);
+	event.end = sinceEpoch(epoch, end);
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::nameThread(const char *name) {
+
+	TraceBuffer *buffer = instance().threadBuffer();
+	std::lock_guard<std::mutex> lock(instance().mutex);
+	buffer->name = name;
+}
+
+const char *Tracer::currentScope() {
+
+	return threadTrace.scope;
+}
+
+void Tracer::setCurrentScope(const char *name) {
+
+	threadTrace.scope = name;
+}
+
+bool Tracer::write(const char *path) {
+
+	stop();
+	std::lock_guard<std::mutex> lock(mutex);
+	FILE *file = fopen(path, "w");
+	if (!file) { return false; }
+
+	//Complete events ("X") with the begin and duration in us, and the names of the threads as metadata
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (std::unique_ptr<TraceBuffer> &buffer : buffers) {
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->id, buffer->name.c_str());
+		first = false;
+		long long written = buffer->written.load(std::memory_order_acquire);
+		for (long long i = std::max(0LL, written - traceBufferEvents); i < written; i++) {
+			const TraceEvent &event = buffer->events[i % traceBufferEvents];
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", event.name, buffer->id, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+	return true;
+}
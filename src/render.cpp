@@ -3,8 +3,11 @@
 #include <glm\gtc\matrix_transform.hpp>
 #include <cstdio>
 #include <cassert>
+#include <vector>
 
 #include "GL_framework.h"
+#include "cloth_grid.h"
+#include "profiler.h"
 
 /////////fw decl
 namespace ImGui {
@@ -78,6 +81,17 @@ void GLmousecb(MouseEvent ev) {
 	prevMouse.lasty = ev.posy;
 }
 
+void GLcursorRay(float x, float y, glm::vec3 &origin, glm::vec3 &direction) {
+	//Ray from the camera through the window point (x, y), window coordinates go down from the top
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glm::vec4 view(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glm::vec3 nearPoint = glm::unProject(glm::vec3(x, view.w - y, 0.f), _modelView, _projection, view);
+	glm::vec3 farPoint = glm::unProject(glm::vec3(x, view.w - y, 1.f), _modelView, _projection, view);
+	origin = nearPoint;
+	direction = glm::normalize(farPoint - nearPoint);
+}
+
 void GLinit(int width, int height) {
 	glViewport(0, 0, width, height);
 	glClearColor(0.2f, 0.2f, 0.2f, 1.f);
@@ -119,6 +133,7 @@ void GLrender() {
 
 	renderPrims();
 
+	PROFILE_SCOPE("ImGui render");
 	ImGui::Render();
 }
 
@@ -725,9 +740,7 @@ GLuint clothVao;
 GLuint clothVbo[2];
 GLuint clothShaders[2];
 GLuint clothProgram;
-extern const int numCols = 14;
-extern const int numRows = 18;
-extern const int numVerts = numRows * numCols;
+ClothGrid meshGrid; //Grid the buffers were built for
 int numVirtualVerts;
 
 const char* cloth_vertShader =
@@ -745,36 +758,44 @@ void main() {\n\
 	out_Color = color;\n\
 }";
 
-void setupClothMesh() {
-	glGenVertexArrays(1, &clothVao);
+void buildClothBuffers() {
+	//Vertex and index buffers depend on the grid, they are rebuilt when its size changes
+	meshGrid = clothGrid;
+	const int numCols = meshGrid.columns;
+	const int numRows = meshGrid.rows;
+
 	glBindVertexArray(clothVao);
-	glGenBuffers(2, clothVbo);
 
 	glBindBuffer(GL_ARRAY_BUFFER, clothVbo[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * numVerts, 0, GL_DYNAMIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * meshGrid.totalVertex(), 0, GL_DYNAMIC_DRAW);
 	glVertexAttribPointer((GLuint)0, 3, GL_FLOAT, GL_FALSE, 0, 0);
 	glEnableVertexAttribArray(0);
 
-	glPrimitiveRestartIndex(UCHAR_MAX);
-	constexpr int facesVertsIdx = 5 * (numCols - 1) * (numRows - 1);
-	GLubyte facesIdx[facesVertsIdx] = { 0 };
+	const int facesVertsIdx = 5 * (numCols - 1) * (numRows - 1);
+	std::vector<GLuint> facesIdx(facesVertsIdx);
 	for (int i = 0; i < (numRows - 1); ++i) {
 		for (int j = 0; j < (numCols - 1); ++j) {
 			facesIdx[5 * (i*(numCols-1) + j) + 0] = i*numCols + j;
 			facesIdx[5 * (i*(numCols-1) + j) + 1] = (i + 1)*numCols + j;
 			facesIdx[5 * (i*(numCols-1) + j) + 2] = (i + 1)*numCols + (j + 1);
 			facesIdx[5 * (i*(numCols-1) + j) + 3] = i*numCols + (j + 1);
-			facesIdx[5 * (i*(numCols-1) + j) + 4] = UCHAR_MAX;
+			facesIdx[5 * (i*(numCols-1) + j) + 4] = UINT_MAX;
 		}
 	}
 	numVirtualVerts = facesVertsIdx;
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, clothVbo[1]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLubyte)*numVirtualVerts, facesIdx, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*numVirtualVerts, facesIdx.data(), GL_STATIC_DRAW);
 
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void setupClothMesh() {
+	glGenVertexArrays(1, &clothVao);
+	glGenBuffers(2, clothVbo);
+	buildClothBuffers();
 
 	clothShaders[0] = compileShader(cloth_vertShader, GL_VERTEX_SHADER, "clothVert");
 	clothShaders[1] = compileShader(cloth_fragShader, GL_FRAGMENT_SHADER, "clothFrag");
@@ -794,9 +815,12 @@ void cleanupClothMesh() {
 	glDeleteShader(clothShaders[1]);
 }
 void updateClothMesh(float *array_data) {
+	if (meshGrid != clothGrid)
+		buildClothBuffers();
+
 	glBindBuffer(GL_ARRAY_BUFFER, clothVbo[0]);
 	float* buff = (float*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-	for (int i = 0; i < 3 * numVerts; ++i) {
+	for (int i = 0; i < 3 * meshGrid.totalVertex(); ++i) {
 		buff[i] = array_data[i];
 	}
 	glUnmapBuffer(GL_ARRAY_BUFFER);
@@ -804,11 +828,12 @@ void updateClothMesh(float *array_data) {
 }
 void drawClothMesh() {
 	glEnable(GL_PRIMITIVE_RESTART);
+	glPrimitiveRestartIndex(UINT_MAX);
 	glBindVertexArray(clothVao);
 	glUseProgram(clothProgram);
 	glUniformMatrix4fv(glGetUniformLocation(clothProgram, "mvpMat"), 1, GL_FALSE, glm::value_ptr(_MVP));
 	glUniform4f(glGetUniformLocation(clothProgram, "color"), 0.1f, 1.f, 1.f, 0.f);
-	glDrawElements(GL_LINE_LOOP, numVirtualVerts, GL_UNSIGNED_BYTE, 0);
+	glDrawElements(GL_LINE_LOOP, numVirtualVerts, GL_UNSIGNED_INT, 0);
 
 	glUseProgram(0);
 	glBindVertexArray(0);
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "ccd.h"
+#include "self_collision.h"
+
+namespace {
+
+	const int nodeGrain = 4096;
+	const int maxCells = 4; //Per axis, stretched triangles and fast nodes only go to the cells around their first corner
+
+	inline glm::ivec3 cellOf(glm::vec3 p, float invCell) {
+
+		return glm::ivec3(glm::floor(p * invCell));
+	}
+
+	inline int hashCell(glm::ivec3 cell, int mask) {
+
+		return (int)(((unsigned)cell.x * 73856093u ^ (unsigned)cell.y * 19349663u ^ (unsigned)cell.z * 83492791u) & (unsigned)mask);
+	}
+
+	//Barycentric coordinates of q, a point of the triangle abc
+	glm::vec3 barycentric(glm::vec3 q, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+
+		glm::vec3 ab = b - a, ac = c - a, aq = q - a;
+		float d00 = glm::dot(ab, ab), d01 = glm::dot(ab, ac), d11 = glm::dot(ac, ac);
+		float d20 = glm::dot(aq, ab), d21 = glm::dot(aq, ac);
+		float denominator = d00 * d11 - d01 * d01;
+		if (denominator <= 0) { return glm::vec3(1.f / 3); }
+		float v = glm::clamp((d11 * d20 - d01 * d21) / denominator, 0.f, 1.f);
+		float w = glm::clamp((d00 * d21 - d01 * d20) / denominator, 0.f, 1.f - v);
+		return glm::vec3(1 - v - w, v, w);
+	}
+
+	//Correction of node i away from a triangle closer than the thickness, on the side the node was at the start of the step.
+	//"weights" are the barycentric coordinates of the closest point, where the triangle gets the opposite correction.
+	//Without a discrete contact at the end of the step, "impact" tells that the continuous test found it crossing on the way
+	bool vertexContact(const ParticleState &state, int i, const glm::ivec3 &triangle, float thickness, bool continuous, glm::vec3 &push, glm::vec3 &weights, bool &impact) {
+
+		glm::vec3 p = state.pos.get(i), last = state.last.get(i);
+		glm::vec3 a = state.pos.get(triangle.x), b = state.pos.get(triangle.y), c = state.pos.get(triangle.z);
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		float area = glm::length(normal);
+		if (area <= 0) { return false; }
+		normal /= area;
+
+		//Side of the triangle the node was on at the start of the step
+		glm::vec3 lastA = state.last.get(triangle.x), lastB = state.last.get(triangle.y), lastC = state.last.get(triangle.z);
+		glm::vec3 lastNormal = glm::cross(lastB - lastA, lastC - lastA);
+		if (glm::dot(normal, lastNormal) < 0) { normal = -normal; }
+		float side = glm::dot(last - lastA, lastNormal) >= 0 ? 1.f : -1.f;
+
+		glm::vec3 q = closestPointTriangle(p, a, b, c);
+		float distance = glm::dot(p - q, normal) * side;
+		if (distance >= thickness) { return false; }
+		glm::vec3 lateral = p - q - glm::dot(p - q, normal) * normal;
+		bool touching = glm::dot(p - q, p - q) < thickness * thickness;
+		bool crossed = distance < 0 && glm::dot(lateral, lateral) < thickness * thickness;
+
+		impact = false;
+		if (!touching && !crossed) {
+			float t;
+			if (!continuous || !vertexTriangleImpact(last, p, lastA, a, lastB, b, lastC, c, thickness, t)) { return false; }
+			impact = true;
+		}
+		push = (thickness - distance) * side * normal;
+		weights = barycentric(q, a, b, c);
+		return true;
+	}
+
+	//Correction of node i, on the edge ij, away from the edge uv when they met during the step. Weighted by how close the
+	//contact is to i, the side is the one of the edges at the start of the step. "r" is the contact point on uv
+	bool edgeContact(const ParticleState &state, int i, int j, int u, int v, float thickness, glm::vec3 &push, float &r) {
+
+		glm::vec3 i0 = state.last.get(i), i1 = state.pos.get(i), j0 = state.last.get(j), j1 = state.pos.get(j);
+		glm::vec3 u0 = state.last.get(u), u1 = state.pos.get(u), v0 = state.last.get(v), v1 = state.pos.get(v);
+
+		//Boxes of the motion of both edges
+		glm::vec3 low = glm::min(glm::min(i0, i1), glm::min(j0, j1)) - thickness, high = glm::max(glm::max(i0, i1), glm::max(j0, j1)) + thickness;
+		glm::vec3 otherLow = glm::min(glm::min(u0, u1), glm::min(v0, v1)), otherHigh = glm::max(glm::max(u0, u1), glm::max(v0, v1));
+		if (glm::any(glm::lessThan(high, otherLow)) || glm::any(glm::greaterThan(low, otherHigh))) { return false; }
+
+		float t, s;
+		if (!edgeEdgeImpact(i0, i1, j0, j1, u0, u1, v0, v1, thickness, t, s, r)) { return false; }
+
+		glm::vec3 normal = glm::cross(j1 - i1, v1 - u1);
+		float length = glm::length(normal);
+		if (length <= 0) { return false; }
+		normal /= length;
+		if (glm::dot(glm::mix(i0, j0, s) - glm::mix(u0, v0, r), normal) < 0) { normal = -normal; }
+
+		float distance = glm::dot(glm::mix(i1, j1, s) - glm::mix(u1, v1, r), normal);
+		if (distance >= thickness) { return false; }
+		push = (1 - s) * (thickness - distance) * normal;
+		return true;
+	}
+}
+
+void SelfCollision::buildTopology(const ClothBVH &bvh, int n, const std::vector<Spring> &springs) {
+
+	topologyGrid = bvh.grid();
+	topologySprings = springs.size();
+	const std::vector<glm::ivec3> &triangles = bvh.triangles();
+
+	//Spring neighbors of every node
+	neighborStart.assign(n + 1, 0);
+	for (const Spring &spring : springs) {
+		neighborStart[spring.i + 1]++;
+		neighborStart[spring.j + 1]++;
+	}
+	for (int i = 0; i < n; i++) { neighborStart[i + 1] += neighborStart[i]; }
+	neighbors.resize(neighborStart[n]);
+	next.assign(neighborStart.begin(), neighborStart.end() - 1);
+	for (const Spring &spring : springs) {
+		neighbors[next[spring.i]++] = spring.j;
+		neighbors[next[spring.j]++] = spring.i;
+	}
+
+	//Triangle edges, every one is tested by the first triangle that has it
+	std::vector<glm::ivec3> edges; //First node, second node and triangle * 3 + edge
+	for (int t = 0; t < (int)triangles.size(); t++) {
+		for (int k = 0; k < 3; k++) {
+			int u = triangles[t][k], v = triangles[t][(k + 1) % 3];
+			edges.push_back({ glm::min(u, v), glm::max(u, v), 3 * t + k });
+		}
+	}
+	std::sort(edges.begin(), edges.end(), [](const glm::ivec3 &a, const glm::ivec3 &b) {
+		return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+	});
+	ownedEdges.assign(triangles.size(), 0);
+	edgeStart.assign(n + 1, 0);
+	for (size_t e = 0; e < edges.size(); e++) {
+		if (e > 0 && edges[e].x == edges[e - 1].x && edges[e].y == edges[e - 1].y) { continue; }
+		ownedEdges[edges[e].z / 3] |= 1 << (edges[e].z % 3);
+		edgeStart[edges[e].x + 1]++;
+		edgeStart[edges[e].y + 1]++;
+	}
+	for (int i = 0; i < n; i++) { edgeStart[i + 1] += edgeStart[i]; }
+	edgeNodes.resize(edgeStart[n]);
+	next.assign(edgeStart.begin(), edgeStart.end() - 1);
+	for (size_t e = 0; e < edges.size(); e++) {
+		if (e > 0 && edges[e].x == edges[e - 1].x && edges[e].y == edges[e - 1].y) { continue; }
+		edgeNodes[next[edges[e].x]++] = edges[e].y;
+		edgeNodes[next[edges[e].y]++] = edges[e].x;
+	}
+}
+
+void SelfCollision::buildHash(const ClothBVH &bvh, float cellSize, ThreadPool &pool) {
+
+	const std::vector<glm::ivec3> &triangles = bvh.triangles();
+	const int n = (int)nodeLow.size();
+	const int triangleCount = (int)triangles.size();
+	const float invCell = 1 / cellSize;
+
+	int tableSize = 1;
+	while (tableSize < 2 * glm::max(n, triangleCount)) { tableSize *= 2; }
+	tableMask = tableSize - 1;
+
+	//Cells of the nodes, and of the triangles grown by the thickness
+	pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			nodeLow[i] = cellOf(nodeBounds[2 * i], invCell);
+			nodeHigh[i] = glm::min(cellOf(nodeBounds[2 * i + 1], invCell), nodeLow[i] + (maxCells - 1));
+		}
+	});
+	triangleLow.resize(triangleCount);
+	triangleHigh.resize(triangleCount);
+	pool.parallelFor(triangleCount, nodeGrain, [&](int begin, int end) {
+		for (int t = begin; t < end; t++) {
+			triangleLow[t] = cellOf(triangleBounds[2 * t], invCell);
+			triangleHigh[t] = glm::min(cellOf(triangleBounds[2 * t + 1], invCell), triangleLow[t] + (maxCells - 1));
+		}
+	});
+
+	//Counting sort of the triangles, entries of a bucket keep the triangle order
+	triangleStart.assign(tableSize + 1, 0);
+	for (int t = 0; t < triangleCount; t++) {
+		for (int x = triangleLow[t].x; x <= triangleHigh[t].x; x++) {
+			for (int y = triangleLow[t].y; y <= triangleHigh[t].y; y++) {
+				for (int z = triangleLow[t].z; z <= triangleHigh[t].z; z++) { triangleStart[hashCell({ x, y, z }, tableMask) + 1]++; }
+			}
+		}
+	}
+	for (int b = 0; b < tableSize; b++) { triangleStart[b + 1] += triangleStart[b]; }
+	sortedTriangles.resize(triangleStart[tableSize]);
+	next.assign(triangleStart.begin(), triangleStart.end() - 1);
+	for (int t = 0; t < triangleCount; t++) {
+		for (int x = triangleLow[t].x; x <= triangleHigh[t].x; x++) {
+			for (int y = triangleLow[t].y; y <= triangleHigh[t].y; y++) {
+				for (int z = triangleLow[t].z; z <= triangleHigh[t].z; z++) { sortedTriangles[next[hashCell({ x, y, z }, tableMask)]++] = t; }
+			}
+		}
+	}
+}
+
+void SelfCollision::solve(ParticleState &state, const std::vector<Spring> &springs, const ClothBVH &bvh, const SelfCollisionParams &params, ThreadPool &pool) {
+
+	const int n = state.count;
+	const float thickness = params.thickness;
+	const bool continuous = params.continuous;
+	const std::vector<glm::ivec3> &triangles = bvh.triangles();
+	if (bvh.grid() != topologyGrid || springs.size() != topologySprings) { buildTopology(bvh, n, springs); }
+
+	//Boxes of the nodes and of the triangles grown by the thickness, the continuous tests need the whole motion of the step
+	nodeBounds.resize(2 * n);
+	nodeLow.resize(n);
+	nodeHigh.resize(n);
+	pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			glm::vec3 p = state.pos.get(i), last = continuous ? state.last.get(i) : p;
+			nodeBounds[2 * i] = glm::min(p, last);
+			nodeBounds[2 * i + 1] = glm::max(p, last);
+		}
+	});
+	triangleBounds.resize(2 * triangles.size());
+	pool.parallelFor((int)triangles.size(), nodeGrain, [&](int begin, int end) {
+		for (int t = begin; t < end; t++) {
+			const glm::ivec3 &triangle = triangles[t];
+			glm::vec3 low = glm::min(nodeBounds[2 * triangle.x], glm::min(nodeBounds[2 * triangle.y], nodeBounds[2 * triangle.z]));
+			glm::vec3 high = glm::max(nodeBounds[2 * triangle.x + 1], glm::max(nodeBounds[2 * triangle.y + 1], nodeBounds[2 * triangle.z + 1]));
+			triangleBounds[2 * t] = low - thickness;
+			triangleBounds[2 * t + 1] = high + thickness;
+		}
+	});
+	if (params.broadphase == SelfCollisionBroadphase::SpatialHash) { buildHash(bvh, params.cellSize, pool); }
+
+	contactLists.resize((n + nodeGrain - 1) / nodeGrain);
+	for (std::vector<SelfContact> &list : contactLists) { list.clear(); }
+	std::atomic<long long> pairsTested(0);
+	std::atomic<int> contacts(0), impacts(0);
+	std::atomic<float> maxCorrection(0);
+
+	//Nodes go in grid order, so every chunk is a patch of the cloth and keeps its triangles in cache
+	pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+		std::vector<SelfContact> &found = contactLists[begin / nodeGrain];
+		long long chunkPairs = 0;
+		int chunkContacts = 0, chunkImpacts = 0;
+
+		for (int i = begin; i < end; i++) {
+			if (state.invMass[i] <= 0) { continue; }
+			glm::vec3 nodeMin = nodeBounds[2 * i], nodeMax = nodeBounds[2 * i + 1];
+
+			auto overlaps = [&](glm::vec3 low, glm::vec3 high) {
+				return !(nodeMax.x < low.x || nodeMax.y < low.y || nodeMax.z < low.z || nodeMin.x > high.x || nodeMin.y > high.y || nodeMin.z > high.z);
+			};
+
+			//Narrow phase of a triangle whose box overlaps the one of the node
+			auto test = [&](int t) {
+
+				//Topological neighbors are never in contact
+				const glm::ivec3 &triangle = triangles[t];
+				bool neighbor = triangle.x == i || triangle.y == i || triangle.z == i;
+				for (int s = neighborStart[i]; s < neighborStart[i + 1] && !neighbor; s++) {
+					neighbor = neighbors[s] == triangle.x || neighbors[s] == triangle.y || neighbors[s] == triangle.z;
+				}
+				if (neighbor) { return; }
+				chunkPairs++;
+
+				glm::vec3 push, weights;
+				bool impact;
+				if (vertexContact(state, i, triangle, thickness, continuous, push, weights, impact)) {
+					found.push_back({ i, triangle, weights, push });
+					chunkContacts++;
+					chunkImpacts += impact;
+				}
+				if (!continuous) { return; }
+
+				//Edges of the node against the edges of the triangle. Contacts near the other end of an edge
+				//are mostly found by the node on that end
+				for (int k = 0; k < 3; k++) {
+					if (!(ownedEdges[t] & (1 << k))) { continue; }
+					int u = triangle[k], v = triangle[(k + 1) % 3];
+					for (int s = edgeStart[i]; s < edgeStart[i + 1]; s++) {
+						int j = edgeNodes[s];
+						if (j == u || j == v) { continue; }
+						float r;
+						if (edgeContact(state, i, j, u, v, thickness, push, r)) {
+							found.push_back({ i, glm::ivec3(u, v, -1), glm::vec3(1 - r, r, 0), push });
+							chunkContacts++;
+							chunkImpacts++;
+						}
+					}
+				}
+			};
+
+			if (params.broadphase == SelfCollisionBroadphase::BVH) {
+				auto overlapsTree = [&](glm::vec3 low, glm::vec3 high) { return overlaps(low - thickness, high + thickness); };
+				bvh.query(overlapsTree, [&](int t) {
+					if (overlaps(triangleBounds[2 * t], triangleBounds[2 * t + 1])) { test(t); }
+				});
+			}
+			else {
+				for (int x = nodeLow[i].x; x <= nodeHigh[i].x; x++) {
+					for (int y = nodeLow[i].y; y <= nodeHigh[i].y; y++) {
+						for (int z = nodeLow[i].z; z <= nodeHigh[i].z; z++) {
+							glm::ivec3 cell = { x, y, z };
+							int bucket = hashCell(cell, tableMask);
+							for (int e = triangleStart[bucket], previous = -1; e < triangleStart[bucket + 1]; e++) {
+								int t = sortedTriangles[e];
+								if (t == previous) { continue; } //Two cells of the triangle on the same bucket
+								previous = t;
+
+								//Other cells hashed to the bucket, or too far from the triangle
+								if (!overlaps(triangleBounds[2 * t], triangleBounds[2 * t + 1])) { continue; }
+
+								//A node and a triangle that share several cells are only tested on the first one
+								if (glm::max(nodeLow[i], triangleLow[t]) != cell) { continue; }
+								test(t);
+							}
+						}
+					}
+				}
+			}
+		}
+		pairsTested += chunkPairs;
+		contacts += chunkContacts;
+		impacts += chunkImpacts;
+	});
+
+	//Half of every push goes to the node and the opposite half to the triangle or the edge, spread by the weights of the
+	//contact point. Added in chunk order, the same whatever the number of threads, and averaged over the pushes of every node
+	pushSum.assign(n, glm::vec3(0, 0, 0));
+	pushCount.assign(n, 0);
+	for (const std::vector<SelfContact> &list : contactLists) {
+		for (const SelfContact &contact : list) {
+			pushSum[contact.node] += contact.push;
+			pushCount[contact.node]++;
+			for (int k = 0; k < 3; k++) {
+				int other = contact.others[k];
+				if (other < 0 || contact.weights[k] <= 0) { continue; }
+				pushSum[other] -= contact.weights[k] * contact.push;
+				pushCount[other]++;
+			}
+		}
+	}
+	correction.assign(n, glm::vec3(0, 0, 0));
+	pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+		float chunkMax = 0;
+		for (int i = begin; i < end; i++) {
+			if (pushCount[i] == 0 || state.invMass[i] <= 0) { continue; }
+			correction[i] = 0.5f * pushSum[i] / (float)pushCount[i];
+			chunkMax = glm::max(chunkMax, glm::length(correction[i]));
+		}
+		float current = maxCorrection;
+		while (chunkMax > current && !maxCorrection.compare_exchange_weak(current, chunkMax)) {}
+	});
+
+	//Move the nodes out and remove their velocity towards the triangles
+	pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			float length = glm::length(correction[i]);
+			if (length <= 0) { continue; }
+			glm::vec3 direction = correction[i] / length;
+			state.pos.set(i, state.pos.get(i) + correction[i]);
+			glm::vec3 velocity = state.vel.get(i);
+			float approaching = glm::dot(velocity, direction);
+			if (approaching < 0) { state.vel.set(i, velocity - approaching * direction); }
+		}
+	});
+
+	lastStats.pairsTested = pairsTested;
+	lastStats.contacts = contacts;
+	lastStats.impacts = impacts;
+	lastStats.maxCorrection = maxCorrection;
+	lastStats.cells = params.broadphase == SelfCollisionBroadphase::SpatialHash ? tableMask + 1 : 0;
+}
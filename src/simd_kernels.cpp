@@ -0,0 +1,591 @@
+#include <glm/glm.hpp>
+#include <cmath>
+
+#include "simd_kernels.h"
+#include "simd_lanes.h"
+
+static_assert(sizeof(Spring) == 4 * sizeof(int), "Spring records are gathered with a stride of 4 ints");
+
+KernelPath bestKernelPath() {
+#if defined(CLOTH_AVX2)
+	return KernelPath::AVX2;
+#elif defined(CLOTH_SSE)
+	return KernelPath::SSE;
+#else
+	return KernelPath::Scalar;
+#endif
+}
+
+const char *kernelPathName(KernelPath path) {
+	switch (path) {
+	case KernelPath::AVX2: return "AVX2";
+	case KernelPath::SSE: return "SSE";
+	default: return "Scalar";
+	}
+}
+
+namespace {
+
+	//Adds the forces of a batch of springs. Two springs of the batch can share a node, so it is done in order
+	template <class Real>
+	inline void scatterForces(BasicSoAVec3<Real> &force, const Spring *springs, int lanes, const Real *fx, const Real *fy, const Real *fz) {
+
+		for (int l = 0; l < lanes; l++) {
+			int i = springs[l].i, j = springs[l].j;
+			force.x[i] += fx[l]; force.y[i] += fy[l]; force.z[i] += fz[l];
+			force.x[j] -= fx[l]; force.y[j] -= fy[l]; force.z[j] -= fz[l];
+		}
+	}
+
+	//Evaluates whole batches of springs and returns how many were done, the rest are left for a narrower path
+	template <class Lanes>
+	int springForces(const BasicSoAVec3<typename Lanes::T> &pos, const BasicSoAVec3<typename Lanes::T> &vel, BasicSoAVec3<typename Lanes::T> &force, const Spring *springs, int count, float Ke, float Kd) {
+
+		typedef typename Lanes::T T;
+		typedef typename Lanes::V V;
+		typedef typename Lanes::I I;
+		const V ke = Lanes::set1(Ke), kd = Lanes::set1(Kd), one = Lanes::set1(1.f), zero = Lanes::set1(0.f);
+		alignas(32) T fx[Lanes::width], fy[Lanes::width], fz[Lanes::width];
+
+		int k = 0;
+		for (; k + Lanes::width <= count; k += Lanes::width) {
+			const int *record = &springs[k].i;
+			I i = Lanes::springIndices(record);
+			I j = Lanes::springIndices(record + 1);
+			V rest = Lanes::loadStride4((const float*)(record + 2));
+
+			//Distance and normal vector
+			V dx = Lanes::sub(Lanes::gather(pos.x, i), Lanes::gather(pos.x, j));
+			V dy = Lanes::sub(Lanes::gather(pos.y, i), Lanes::gather(pos.y, j));
+			V dz = Lanes::sub(Lanes::gather(pos.z, i), Lanes::gather(pos.z, j));
+			V distance = Lanes::sqrt(Lanes::add(Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy)), Lanes::mul(dz, dz)));
+			V inv = Lanes::div(one, distance);
+			V nx = Lanes::mul(dx, inv), ny = Lanes::mul(dy, inv), nz = Lanes::mul(dz, inv);
+
+			//Relative velocity along the normal
+			V dvx = Lanes::sub(Lanes::gather(vel.x, i), Lanes::gather(vel.x, j));
+			V dvy = Lanes::sub(Lanes::gather(vel.y, i), Lanes::gather(vel.y, j));
+			V dvz = Lanes::sub(Lanes::gather(vel.z, i), Lanes::gather(vel.z, j));
+			V damping = Lanes::mul(kd, Lanes::add(Lanes::add(Lanes::mul(dvx, nx), Lanes::mul(dvy, ny)), Lanes::mul(dvz, nz)));
+
+			//-(Ke * (distance - rest) + Kd * dv.n) * n
+			V calc = Lanes::sub(zero, Lanes::add(Lanes::mul(ke, Lanes::sub(distance, rest)), damping));
+			Lanes::store(fx, Lanes::mul(calc, nx));
+			Lanes::store(fy, Lanes::mul(calc, ny));
+			Lanes::store(fz, Lanes::mul(calc, nz));
+			scatterForces(force, springs + k, Lanes::width, fx, fy, fz);
+		}
+		return k;
+	}
+
+	template <class Lanes>
+	struct Acceleration {
+		typename Lanes::V gx, gy, gz;
+
+		explicit Acceleration(glm::vec3 gravity) : gx(Lanes::set1(gravity.x)), gy(Lanes::set1(gravity.y)), gz(Lanes::set1(gravity.z)) {}
+
+		//w * (f + g) of the nodes [i, i + width)
+		void get(const float *invMass, const SoAVec3 &force, int i, typename Lanes::V &ax, typename Lanes::V &ay, typename Lanes::V &az) const {
+			typename Lanes::V w = Lanes::load(invMass + i);
+			ax = Lanes::mul(w, Lanes::add(Lanes::load(force.x + i), gx));
+			ay = Lanes::mul(w, Lanes::add(Lanes::load(force.y + i), gy));
+			az = Lanes::mul(w, Lanes::add(Lanes::load(force.z + i), gz));
+		}
+	};
+
+	template <class Lanes>
+	void explicitEuler(ParticleState &s, float dt, glm::vec3 gravity) {
+
+		typedef typename Lanes::V V;
+		const V step = Lanes::set1(dt);
+		const Acceleration<Lanes> acceleration(gravity);
+
+		for (int i = 0; i < s.capacity; i += Lanes::width) {
+			V ax, ay, az;
+			acceleration.get(s.invMass, s.force, i, ax, ay, az);
+			V x = Lanes::load(s.pos.x + i), y = Lanes::load(s.pos.y + i), z = Lanes::load(s.pos.z + i);
+			V vx = Lanes::load(s.vel.x + i), vy = Lanes::load(s.vel.y + i), vz = Lanes::load(s.vel.z + i);
+			Lanes::store(s.last.x + i, x); Lanes::store(s.last.y + i, y); Lanes::store(s.last.z + i, z);
+
+			Lanes::store(s.pos.x + i, Lanes::add(x, Lanes::mul(step, vx)));
+			Lanes::store(s.pos.y + i, Lanes::add(y, Lanes::mul(step, vy)));
+			Lanes::store(s.pos.z + i, Lanes::add(z, Lanes::mul(step, vz)));
+			Lanes::store(s.vel.x + i, Lanes::add(vx, Lanes::mul(step, ax)));
+			Lanes::store(s.vel.y + i, Lanes::add(vy, Lanes::mul(step, ay)));
+			Lanes::store(s.vel.z + i, Lanes::add(vz, Lanes::mul(step, az)));
+		}
+	}
+
+	template <class Lanes>
+	void symplecticEuler(ParticleState &s, float dt, glm::vec3 gravity) {
+
+		typedef typename Lanes::V V;
+		const V step = Lanes::set1(dt);
+		const Acceleration<Lanes> acceleration(gravity);
+
+		for (int i = 0; i < s.capacity; i += Lanes::width) {
+			V ax, ay, az;
+			acceleration.get(s.invMass, s.force, i, ax, ay, az);
+			V x = Lanes::load(s.pos.x + i), y = Lanes::load(s.pos.y + i), z = Lanes::load(s.pos.z + i);
+			Lanes::store(s.last.x + i, x); Lanes::store(s.last.y + i, y); Lanes::store(s.last.z + i, z);
+
+			V vx = Lanes::add(Lanes::load(s.vel.x + i), Lanes::mul(step, ax));
+			V vy = Lanes::add(Lanes::load(s.vel.y + i), Lanes::mul(step, ay));
+			V vz = Lanes::add(Lanes::load(s.vel.z + i), Lanes::mul(step, az));
+			Lanes::store(s.vel.x + i, vx); Lanes::store(s.vel.y + i, vy); Lanes::store(s.vel.z + i, vz);
+
+			Lanes::store(s.pos.x + i, Lanes::add(x, Lanes::mul(step, vx)));
+			Lanes::store(s.pos.y + i, Lanes::add(y, Lanes::mul(step, vy)));
+			Lanes::store(s.pos.z + i, Lanes::add(z, Lanes::mul(step, vz)));
+		}
+	}
+
+	template <class Lanes>
+	void verlet(ParticleState &s, float dt, glm::vec3 gravity) {
+
+		typedef typename Lanes::V V;
+		const V step2 = Lanes::set1(dt * dt), invStep = Lanes::set1(1.f / dt);
+		const Acceleration<Lanes> acceleration(gravity);
+
+		for (int i = 0; i < s.capacity; i += Lanes::width) {
+			V ax, ay, az;
+			acceleration.get(s.invMass, s.force, i, ax, ay, az);
+			V x = Lanes::load(s.pos.x + i), y = Lanes::load(s.pos.y + i), z = Lanes::load(s.pos.z + i);
+
+			//Displacement of this step: (x - last) + dt^2 * a
+			V mx = Lanes::add(Lanes::sub(x, Lanes::load(s.last.x + i)), Lanes::mul(step2, ax));
+			V my = Lanes::add(Lanes::sub(y, Lanes::load(s.last.y + i)), Lanes::mul(step2, ay));
+			V mz = Lanes::add(Lanes::sub(z, Lanes::load(s.last.z + i)), Lanes::mul(step2, az));
+			Lanes::store(s.last.x + i, x); Lanes::store(s.last.y + i, y); Lanes::store(s.last.z + i, z);
+
+			Lanes::store(s.pos.x + i, Lanes::add(x, mx));
+			Lanes::store(s.pos.y + i, Lanes::add(y, my));
+			Lanes::store(s.pos.z + i, Lanes::add(z, mz));
+			Lanes::store(s.vel.x + i, Lanes::mul(mx, invStep));
+			Lanes::store(s.vel.y + i, Lanes::mul(my, invStep));
+			Lanes::store(s.vel.z + i, Lanes::mul(mz, invStep));
+		}
+	}
+
+	template <class Lanes>
+	void rk4StageImpl(const ParticleState &s, SoAVec3 &stagePos, SoAVec3 &stageVel, const SoAVec3 &stageForce, SoAVec3 &sumPos, SoAVec3 &sumVel, float weight, float next, glm::vec3 gravity) {
+
+		typedef typename Lanes::V V;
+		const V w = Lanes::set1(weight), h = Lanes::set1(next);
+		const Acceleration<Lanes> acceleration(gravity);
+
+		for (int i = 0; i < s.capacity; i += Lanes::width) {
+			V ax, ay, az;
+			acceleration.get(s.invMass, stageForce, i, ax, ay, az);
+			V vx = Lanes::load(stageVel.x + i), vy = Lanes::load(stageVel.y + i), vz = Lanes::load(stageVel.z + i);
+
+			Lanes::store(sumPos.x + i, Lanes::add(Lanes::load(sumPos.x + i), Lanes::mul(w, vx)));
+			Lanes::store(sumPos.y + i, Lanes::add(Lanes::load(sumPos.y + i), Lanes::mul(w, vy)));
+			Lanes::store(sumPos.z + i, Lanes::add(Lanes::load(sumPos.z + i), Lanes::mul(w, vz)));
+			Lanes::store(sumVel.x + i, Lanes::add(Lanes::load(sumVel.x + i), Lanes::mul(w, ax)));
+			Lanes::store(sumVel.y + i, Lanes::add(Lanes::load(sumVel.y + i), Lanes::mul(w, ay)));
+			Lanes::store(sumVel.z + i, Lanes::add(Lanes::load(sumVel.z + i), Lanes::mul(w, az)));
+
+			Lanes::store(stagePos.x + i, Lanes::add(Lanes::load(s.pos.x + i), Lanes::mul(h, vx)));
+			Lanes::store(stagePos.y + i, Lanes::add(Lanes::load(s.pos.y + i), Lanes::mul(h, vy)));
+			Lanes::store(stagePos.z + i, Lanes::add(Lanes::load(s.pos.z + i), Lanes::mul(h, vz)));
+			Lanes::store(stageVel.x + i, Lanes::add(Lanes::load(s.vel.x + i), Lanes::mul(h, ax)));
+			Lanes::store(stageVel.y + i, Lanes::add(Lanes::load(s.vel.y + i), Lanes::mul(h, ay)));
+			Lanes::store(stageVel.z + i, Lanes::add(Lanes::load(s.vel.z + i), Lanes::mul(h, az)));
+		}
+	}
+
+	template <class Lanes>
+	void rk4FinishImpl(ParticleState &s, const SoAVec3 &sumPos, const SoAVec3 &sumVel, float dt) {
+
+		typedef typename Lanes::V V;
+		const V step = Lanes::set1(dt / 6);
+
+		for (int i = 0; i < s.capacity; i += Lanes::width) {
+			V x = Lanes::load(s.pos.x + i), y = Lanes::load(s.pos.y + i), z = Lanes::load(s.pos.z + i);
+			Lanes::store(s.last.x + i, x); Lanes::store(s.last.y + i, y); Lanes::store(s.last.z + i, z);
+
+			Lanes::store(s.pos.x + i, Lanes::add(x, Lanes::mul(step, Lanes::load(sumPos.x + i))));
+			Lanes::store(s.pos.y + i, Lanes::add(y, Lanes::mul(step, Lanes::load(sumPos.y + i))));
+			Lanes::store(s.pos.z + i, Lanes::add(z, Lanes::mul(step, Lanes::load(sumPos.z + i))));
+			Lanes::store(s.vel.x + i, Lanes::add(Lanes::load(s.vel.x + i), Lanes::mul(step, Lanes::load(sumVel.x + i))));
+			Lanes::store(s.vel.y + i, Lanes::add(Lanes::load(s.vel.y + i), Lanes::mul(step, Lanes::load(sumVel.y + i))));
+			Lanes::store(s.vel.z + i, Lanes::add(Lanes::load(s.vel.z + i), Lanes::mul(step, Lanes::load(sumVel.z + i))));
+		}
+	}
+
+	//Lanes of position, last position and velocity of a block of nodes
+	template <class Lanes>
+	struct CollisionLanes {
+		typedef typename Lanes::V V;
+		V x, y, z, lx, ly, lz, vx, vy, vz;
+		V movable; //Mask of the nodes with invMass > 0
+		V bounce; //1 + elasticity of the current collider
+
+		void load(const ParticleState &s, int i) {
+			x = Lanes::load(s.pos.x + i); y = Lanes::load(s.pos.y + i); z = Lanes::load(s.pos.z + i);
+			lx = Lanes::load(s.last.x + i); ly = Lanes::load(s.last.y + i); lz = Lanes::load(s.last.z + i);
+			vx = Lanes::load(s.vel.x + i); vy = Lanes::load(s.vel.y + i); vz = Lanes::load(s.vel.z + i);
+			movable = Lanes::lessThan(Lanes::set1(0.f), Lanes::load(s.invMass + i));
+		}
+
+		void store(ParticleState &s, int i) const {
+			Lanes::store(s.pos.x + i, x); Lanes::store(s.pos.y + i, y); Lanes::store(s.pos.z + i, z);
+			Lanes::store(s.last.x + i, lx); Lanes::store(s.last.y + i, ly); Lanes::store(s.last.z + i, lz);
+			Lanes::store(s.vel.x + i, vx); Lanes::store(s.vel.y + i, vy); Lanes::store(s.vel.z + i, vz);
+		}
+
+		static V dot(V ax, V ay, V az, V bx, V by, V bz) { return Lanes::add(Lanes::add(Lanes::mul(ax, bx), Lanes::mul(ay, by)), Lanes::mul(az, bz)); }
+
+		//Nodes at "distance" < 0 along the contact normal n are mirrored out with the elasticity ("bounce"): position, last
+		//position (at "lastDistance") and, when they move towards the shape, the normal velocity relative to it. Nodes already
+		//moving out keep their velocity. Friction removes up to friction * normal impulse of the relative tangential velocity
+		void respond(V nx, V ny, V nz, V distance, V lastDistance, const Collider &collider) {
+
+			const V zero = Lanes::set1(0.f);
+			V mask = Lanes::both(movable, Lanes::lessThan(distance, zero));
+			if (!Lanes::any(mask)) { return; }
+
+			V push = Lanes::mul(bounce, distance);
+			x = Lanes::select(mask, Lanes::sub(x, Lanes::mul(push, nx)), x);
+			y = Lanes::select(mask, Lanes::sub(y, Lanes::mul(push, ny)), y);
+			z = Lanes::select(mask, Lanes::sub(z, Lanes::mul(push, nz)), z);
+			V lastPush = Lanes::mul(bounce, lastDistance);
+			lx = Lanes::select(mask, Lanes::sub(lx, Lanes::mul(lastPush, nx)), lx);
+			ly = Lanes::select(mask, Lanes::sub(ly, Lanes::mul(lastPush, ny)), ly);
+			lz = Lanes::select(mask, Lanes::sub(lz, Lanes::mul(lastPush, nz)), lz);
+
+			V ux = Lanes::sub(vx, Lanes::set1(collider.velocity.x));
+			V uy = Lanes::sub(vy, Lanes::set1(collider.velocity.y));
+			V uz = Lanes::sub(vz, Lanes::set1(collider.velocity.z));
+			V normalVelocity = dot(ux, uy, uz, nx, ny, nz);
+			V approaching = Lanes::both(mask, Lanes::lessThan(normalVelocity, zero));
+			if (!Lanes::any(approaching)) { return; }
+			V rx = Lanes::sub(vx, Lanes::mul(Lanes::mul(bounce, normalVelocity), nx));
+			V ry = Lanes::sub(vy, Lanes::mul(Lanes::mul(bounce, normalVelocity), ny));
+			V rz = Lanes::sub(vz, Lanes::mul(Lanes::mul(bounce, normalVelocity), nz));
+
+			if (collider.friction > 0) {
+				V tx = Lanes::sub(ux, Lanes::mul(normalVelocity, nx));
+				V ty = Lanes::sub(uy, Lanes::mul(normalVelocity, ny));
+				V tz = Lanes::sub(uz, Lanes::mul(normalVelocity, nz));
+				V tangential = Lanes::add(Lanes::sqrt(dot(tx, ty, tz, tx, ty, tz)), Lanes::set1(1e-12f));
+				V impulse = Lanes::mul(bounce, Lanes::max(normalVelocity, Lanes::sub(zero, normalVelocity)));
+				V keep = Lanes::max(zero, Lanes::sub(Lanes::set1(1.f), Lanes::div(Lanes::mul(Lanes::set1(collider.friction), impulse), tangential)));
+				V remove = Lanes::sub(Lanes::set1(1.f), keep);
+				rx = Lanes::sub(rx, Lanes::mul(remove, tx));
+				ry = Lanes::sub(ry, Lanes::mul(remove, ty));
+				rz = Lanes::sub(rz, Lanes::mul(remove, tz));
+			}
+			vx = Lanes::select(approaching, rx, vx);
+			vy = Lanes::select(approaching, ry, vy);
+			vz = Lanes::select(approaching, rz, vz);
+		}
+
+		void plane(glm::vec3 normal, float offset, const Collider &collider) {
+
+			V nx = Lanes::set1(normal.x), ny = Lanes::set1(normal.y), nz = Lanes::set1(normal.z), d = Lanes::set1(offset);
+			respond(nx, ny, nz, Lanes::add(dot(x, y, z, nx, ny, nz), d), Lanes::add(dot(lx, ly, lz, nx, ny, nz), d), collider);
+		}
+
+		//Outside of the sphere of "radius" around (cx, cy, cz). With "swept", the motion of the node relative to the sphere,
+		//from its last position moved by "shift" (what the sphere moved on the step), is tested against the sphere. Nodes that
+		//entered it on the step are pushed out along the normal where they entered, even if they ended on the other side
+		void sphere(V cx, V cy, V cz, float radius, const Collider &collider, bool swept, glm::vec3 shift) {
+
+			const V zero = Lanes::set1(0.f);
+			V dx = Lanes::sub(x, cx), dy = Lanes::sub(y, cy), dz = Lanes::sub(z, cz);
+			V length = Lanes::sqrt(dot(dx, dy, dz, dx, dy, dz));
+			V r = Lanes::set1(radius);
+			V distance = Lanes::sub(length, r);
+			V inside = Lanes::lessThan(distance, zero);
+
+			V inv = Lanes::div(Lanes::set1(1.f), Lanes::add(length, Lanes::set1(1e-12f)));
+			V nx = Lanes::mul(dx, inv), ny = Lanes::mul(dy, inv), nz = Lanes::mul(dz, inv);
+
+			if (swept) {
+				//First time |o + t m| = r on [0, 1], with o the start and m the motion relative to the center
+				V ox = Lanes::sub(Lanes::add(lx, Lanes::set1(shift.x)), cx);
+				V oy = Lanes::sub(Lanes::add(ly, Lanes::set1(shift.y)), cy);
+				V oz = Lanes::sub(Lanes::add(lz, Lanes::set1(shift.z)), cz);
+				V mx = Lanes::sub(dx, ox), my = Lanes::sub(dy, oy), mz = Lanes::sub(dz, oz);
+				V a = dot(mx, my, mz, mx, my, mz), b = dot(ox, oy, oz, mx, my, mz);
+				V c = Lanes::sub(dot(ox, oy, oz, ox, oy, oz), Lanes::mul(r, r));
+				V discriminant = Lanes::sub(Lanes::mul(b, b), Lanes::mul(a, c));
+				V root = Lanes::sqrt(Lanes::max(discriminant, zero));
+				V entry = Lanes::sub(zero, Lanes::add(b, root)); //t * a
+				V entering = Lanes::both(Lanes::both(Lanes::lessThan(zero, c), Lanes::lessThan(zero, Lanes::add(discriminant, Lanes::set1(1e-30f)))),
+					Lanes::both(Lanes::lessThan(b, zero), Lanes::lessThan(entry, Lanes::add(a, Lanes::set1(1e-30f)))));
+				if (Lanes::any(Lanes::both(movable, entering))) {
+					V t = Lanes::div(entry, Lanes::max(a, Lanes::set1(1e-30f)));
+					V invR = Lanes::set1(1 / radius);
+					nx = Lanes::select(entering, Lanes::mul(Lanes::add(ox, Lanes::mul(t, mx)), invR), nx);
+					ny = Lanes::select(entering, Lanes::mul(Lanes::add(oy, Lanes::mul(t, my)), invR), ny);
+					nz = Lanes::select(entering, Lanes::mul(Lanes::add(oz, Lanes::mul(t, mz)), invR), nz);
+					distance = Lanes::select(entering, Lanes::sub(dot(dx, dy, dz, nx, ny, nz), r), distance);
+					inside = Lanes::select(entering, Lanes::lessThan(distance, zero), inside);
+				}
+			}
+			if (!Lanes::any(Lanes::both(movable, inside))) { return; }
+
+			V lastDistance = Lanes::sub(dot(Lanes::sub(lx, cx), Lanes::sub(ly, cy), Lanes::sub(lz, cz), nx, ny, nz), r);
+			respond(nx, ny, nz, distance, lastDistance, collider);
+		}
+	};
+
+	//Box of the positions of a block of nodes, with "swept" of their whole motion on the step
+	template <class Lanes>
+	void blockBounds(const ParticleState &s, int i, bool swept, glm::vec3 &low, glm::vec3 &high) {
+
+		low = high = s.pos.get(i);
+		for (int l = 0; l < Lanes::width; l++) {
+			low = glm::min(low, s.pos.get(i + l));
+			high = glm::max(high, s.pos.get(i + l));
+			if (swept) {
+				low = glm::min(low, s.last.get(i + l));
+				high = glm::max(high, s.last.get(i + l));
+			}
+		}
+	}
+
+	//With "elasticity", slot i uses elasticity[i % lanes] for every collider instead of their own (ensembles)
+	template <class Lanes>
+	void collideNodesImpl(ParticleState &s, int begin, int end, const Collider *colliders, int count, float dt, bool swept, const float *elasticity, int lanes) {
+
+		typedef typename Lanes::V V;
+		CollisionLanes<Lanes> nodes;
+
+		for (int i = begin; i < end; i += Lanes::width) {
+
+			//Bounds of the block, colliders that can't reach it are skipped
+			glm::vec3 low, high;
+			blockBounds<Lanes>(s, i, swept, low, high);
+
+			bool loaded = false;
+			for (int c = 0; c < count; c++) {
+				const Collider &collider = colliders[c];
+				glm::vec3 shift = swept ? collider.velocity * dt : glm::vec3(0, 0, 0);
+				if (!collider.enabled || !colliderMayTouch(collider, low, high, shift)) { continue; }
+				if (!loaded) {
+					nodes.load(s, i);
+					loaded = true;
+					if (!Lanes::any(nodes.movable)) { break; }
+				}
+				nodes.bounce = elasticity ? Lanes::add(Lanes::set1(1.f), Lanes::load(elasticity + i % lanes)) : Lanes::set1(1 + collider.elasticity);
+
+				switch (collider.type) {
+				case ColliderType::Plane:
+					nodes.plane(collider.normal, collider.offset, collider);
+					break;
+				case ColliderType::Box: //Six planes facing inwards
+					nodes.plane({ 0, 1, 0 }, -collider.min.y, collider);
+					nodes.plane({ 0, -1, 0 }, collider.max.y, collider);
+					nodes.plane({ 1, 0, 0 }, -collider.min.x, collider);
+					nodes.plane({ -1, 0, 0 }, collider.max.x, collider);
+					nodes.plane({ 0, 0, -1 }, collider.max.z, collider);
+					nodes.plane({ 0, 0, 1 }, -collider.min.z, collider);
+					break;
+				case ColliderType::Sphere:
+					nodes.sphere(Lanes::set1(collider.center.x), Lanes::set1(collider.center.y), Lanes::set1(collider.center.z), collider.radius, collider, swept, shift);
+					break;
+				case ColliderType::Capsule: { //Sphere around the point of the segment closest to the node, or to its motion when swept
+					glm::vec3 axis = collider.end - collider.center;
+					float invLength2 = glm::dot(axis, axis) > 0 ? 1.f / glm::dot(axis, axis) : 0.f;
+					V ax = Lanes::set1(axis.x), ay = Lanes::set1(axis.y), az = Lanes::set1(axis.z);
+					V ox = Lanes::set1(collider.center.x), oy = Lanes::set1(collider.center.y), oz = Lanes::set1(collider.center.z);
+					V rx = Lanes::sub(nodes.x, ox), ry = Lanes::sub(nodes.y, oy), rz = Lanes::sub(nodes.z, oz);
+					V t = Lanes::mul(CollisionLanes<Lanes>::dot(rx, ry, rz, ax, ay, az), Lanes::set1(invLength2));
+					if (swept) {
+						//Closest points of the motion and the segment (Ericson, Real-Time Collision Detection 5.1.9), only the one of the segment is kept
+						const V zero = Lanes::set1(0.f), one = Lanes::set1(1.f), epsilon = Lanes::set1(1e-12f);
+						rx = Lanes::sub(Lanes::add(nodes.lx, Lanes::set1(shift.x)), ox);
+						ry = Lanes::sub(Lanes::add(nodes.ly, Lanes::set1(shift.y)), oy);
+						rz = Lanes::sub(Lanes::add(nodes.lz, Lanes::set1(shift.z)), oz);
+						V mx = Lanes::sub(Lanes::sub(nodes.x, ox), rx), my = Lanes::sub(Lanes::sub(nodes.y, oy), ry), mz = Lanes::sub(Lanes::sub(nodes.z, oz), rz);
+						V a = CollisionLanes<Lanes>::dot(mx, my, mz, mx, my, mz), b = CollisionLanes<Lanes>::dot(mx, my, mz, ax, ay, az);
+						V c = CollisionLanes<Lanes>::dot(mx, my, mz, rx, ry, rz), f = CollisionLanes<Lanes>::dot(ax, ay, az, rx, ry, rz);
+						V e = Lanes::set1(glm::dot(axis, axis));
+						V denominator = Lanes::sub(Lanes::mul(a, e), Lanes::mul(b, b));
+						V motion = Lanes::div(Lanes::sub(Lanes::mul(b, f), Lanes::mul(c, e)), Lanes::max(denominator, epsilon));
+						motion = Lanes::select(Lanes::lessThan(epsilon, denominator), Lanes::min(one, Lanes::max(zero, motion)), zero);
+						t = Lanes::mul(Lanes::add(Lanes::mul(b, motion), f), Lanes::set1(invLength2));
+					}
+					t = Lanes::min(Lanes::set1(1.f), Lanes::max(Lanes::set1(0.f), t));
+					nodes.sphere(Lanes::add(ox, Lanes::mul(t, ax)), Lanes::add(oy, Lanes::mul(t, ay)), Lanes::add(oz, Lanes::mul(t, az)), collider.radius, collider, swept, shift);
+					break;
+				}
+				}
+
+				//The next colliders are tested with the new positions
+				nodes.store(s, i);
+				blockBounds<Lanes>(s, i, swept, low, high);
+			}
+		}
+	}
+
+	//Ensembles: springs in order, every one on all the lanes at once. The lanes are different instances, so
+	//node i and node j of a spring are whole vectors and there are no conflicts to scatter
+	template <class Lanes>
+	void ensembleForces(const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force, const Spring *springs, int count, const float *Ke, const float *Kd, int lanes) {
+
+		typedef typename Lanes::V V;
+		const V one = Lanes::set1(1.f), zero = Lanes::set1(0.f);
+
+		for (int k = 0; k < count; k++) {
+			const Spring &spring = springs[k];
+			const V rest = Lanes::set1(spring.restLength);
+			for (int l = 0; l < lanes; l += Lanes::width) {
+				int i = spring.i * lanes + l, j = spring.j * lanes + l;
+				const V ke = Lanes::load(Ke + l), kd = Lanes::load(Kd + l);
+
+				V dx = Lanes::sub(Lanes::load(pos.x + i), Lanes::load(pos.x + j));
+				V dy = Lanes::sub(Lanes::load(pos.y + i), Lanes::load(pos.y + j));
+				V dz = Lanes::sub(Lanes::load(pos.z + i), Lanes::load(pos.z + j));
+				V distance = Lanes::sqrt(Lanes::add(Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy)), Lanes::mul(dz, dz)));
+				V inv = Lanes::div(one, distance);
+				V nx = Lanes::mul(dx, inv), ny = Lanes::mul(dy, inv), nz = Lanes::mul(dz, inv);
+
+				V dvx = Lanes::sub(Lanes::load(vel.x + i), Lanes::load(vel.x + j));
+				V dvy = Lanes::sub(Lanes::load(vel.y + i), Lanes::load(vel.y + j));
+				V dvz = Lanes::sub(Lanes::load(vel.z + i), Lanes::load(vel.z + j));
+				V damping = Lanes::mul(kd, Lanes::add(Lanes::add(Lanes::mul(dvx, nx), Lanes::mul(dvy, ny)), Lanes::mul(dvz, nz)));
+
+				V calc = Lanes::sub(zero, Lanes::add(Lanes::mul(ke, Lanes::sub(distance, rest)), damping));
+				V fx = Lanes::mul(calc, nx), fy = Lanes::mul(calc, ny), fz = Lanes::mul(calc, nz);
+				Lanes::store(force.x + i, Lanes::add(Lanes::load(force.x + i), fx));
+				Lanes::store(force.y + i, Lanes::add(Lanes::load(force.y + i), fy));
+				Lanes::store(force.z + i, Lanes::add(Lanes::load(force.z + i), fz));
+				Lanes::store(force.x + j, Lanes::sub(Lanes::load(force.x + j), fx));
+				Lanes::store(force.y + j, Lanes::sub(Lanes::load(force.y + j), fy));
+				Lanes::store(force.z + j, Lanes::sub(Lanes::load(force.z + j), fz));
+			}
+		}
+	}
+
+	//Gauss-Seidel strain limiting of the structural and shear springs, with the max length of every lane.
+	//A lane stops sweeping after the sweep that left all its springs within the tolerance, as limitStrain does
+	template <class Lanes>
+	void ensembleStrain(SoAVec3 &pos, const float *invMass, const Spring *springs, int count, const float *maxScale, int lanes, int iterations, float tolerance) {
+
+		typedef typename Lanes::V V;
+		const V zero = Lanes::set1(0.f), one = Lanes::set1(1.f), slack = Lanes::set1(tolerance);
+		alignas(32) float active[maxEnsembleLanes], over[maxEnsembleLanes];
+		for (int l = 0; l < lanes; l++) { active[l] = 1; }
+
+		for (int iteration = 0; iteration < iterations; iteration++) {
+			for (int l = 0; l < lanes; l++) { over[l] = 0; }
+			for (int k = 0; k < count; k++) {
+				const Spring &spring = springs[k];
+				if (spring.kind == SpringKind::Bending) { continue; }
+				const V rest = Lanes::set1(spring.restLength);
+				for (int l = 0; l < lanes; l += Lanes::width) {
+					int i = spring.i * lanes + l, j = spring.j * lanes + l;
+					V wi = Lanes::load(invMass + i), wj = Lanes::load(invMass + j);
+					V xi = Lanes::load(pos.x + i), yi = Lanes::load(pos.y + i), zi = Lanes::load(pos.z + i);
+					V xj = Lanes::load(pos.x + j), yj = Lanes::load(pos.y + j), zj = Lanes::load(pos.z + j);
+					V dx = Lanes::sub(xi, xj), dy = Lanes::sub(yi, yj), dz = Lanes::sub(zi, zj);
+					V distance = Lanes::sqrt(Lanes::add(Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy)), Lanes::mul(dz, dz)));
+					V maxLength = Lanes::mul(rest, Lanes::load(maxScale + l));
+					V weights = Lanes::add(wi, wj);
+					V stretched = Lanes::both(Lanes::both(Lanes::lessThan(maxLength, distance), Lanes::lessThan(zero, weights)), Lanes::lessThan(zero, Lanes::load(active + l)));
+					if (!Lanes::any(stretched)) { continue; }
+					V tooLong = Lanes::both(stretched, Lanes::lessThan(Lanes::add(maxLength, Lanes::mul(slack, rest)), distance));
+					Lanes::store(over + l, Lanes::max(Lanes::load(over + l), Lanes::select(tooLong, one, zero)));
+
+					//Same correction as limitStrain, the lanes that aren't stretched keep their positions
+					V factor = Lanes::div(Lanes::sub(maxLength, distance), Lanes::mul(weights, distance));
+					V cx = Lanes::mul(factor, dx), cy = Lanes::mul(factor, dy), cz = Lanes::mul(factor, dz);
+					Lanes::store(pos.x + i, Lanes::select(stretched, Lanes::add(xi, Lanes::mul(wi, cx)), xi));
+					Lanes::store(pos.y + i, Lanes::select(stretched, Lanes::add(yi, Lanes::mul(wi, cy)), yi));
+					Lanes::store(pos.z + i, Lanes::select(stretched, Lanes::add(zi, Lanes::mul(wi, cz)), zi));
+					Lanes::store(pos.x + j, Lanes::select(stretched, Lanes::sub(xj, Lanes::mul(wj, cx)), xj));
+					Lanes::store(pos.y + j, Lanes::select(stretched, Lanes::sub(yj, Lanes::mul(wj, cy)), yj));
+					Lanes::store(pos.z + j, Lanes::select(stretched, Lanes::sub(zj, Lanes::mul(wj, cz)), zj));
+				}
+			}
+
+			bool sweeping = false;
+			for (int l = 0; l < lanes; l++) {
+				active[l] = over[l];
+				sweeping = sweeping || over[l] > 0;
+			}
+			if (!sweeping) { return; }
+		}
+	}
+}
+
+//Runs "kernel" instantiated for the lanes of the selected path
+#if defined(CLOTH_AVX2)
+#define DISPATCH_AVX2(kernel, ...) case KernelPath::AVX2: kernel<AVX2Lanes>(__VA_ARGS__); return;
+#else
+#define DISPATCH_AVX2(kernel, ...)
+#endif
+#if defined(CLOTH_SSE)
+#define DISPATCH_SSE(kernel, ...) case KernelPath::SSE: kernel<SSELanes>(__VA_ARGS__); return;
+#else
+#define DISPATCH_SSE(kernel, ...)
+#endif
+#define DISPATCH(path, kernel, ...) \
+	switch (path) { \
+	DISPATCH_AVX2(kernel, __VA_ARGS__) \
+	DISPATCH_SSE(kernel, __VA_ARGS__) \
+	default: kernel<ScalarLanes>(__VA_ARGS__); return; \
+	}
+
+void accumulateSpringForces(KernelPath path, const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force, const Spring *springs, int count, float Ke, float Kd) {
+
+	int done = 0;
+	switch (path) {
+#if defined(CLOTH_AVX2)
+	case KernelPath::AVX2: done = springForces<AVX2Lanes>(pos, vel, force, springs, count, Ke, Kd); break;
+#endif
+#if defined(CLOTH_SSE)
+	case KernelPath::SSE: done = springForces<SSELanes>(pos, vel, force, springs, count, Ke, Kd); break;
+#endif
+	default: break;
+	}
+
+	//Springs that don't fill a whole batch
+	springForces<ScalarLanes>(pos, vel, force, springs + done, count - done, Ke, Kd);
+}
+
+void accumulateSpringForcesDouble(const SoAVec3Double &pos, const SoAVec3Double &vel, SoAVec3Double &force, const Spring *springs, int count, float Ke, float Kd) {
+
+	springForces<ScalarLanesDouble>(pos, vel, force, springs, count, Ke, Kd);
+}
+
+void integrateExplicitEuler(KernelPath path, ParticleState &state, float dt, glm::vec3 gravity) {
+	DISPATCH(path, explicitEuler, state, dt, gravity)
+}
+
+void integrateSymplecticEuler(KernelPath path, ParticleState &state, float dt, glm::vec3 gravity) {
+	DISPATCH(path, symplecticEuler, state, dt, gravity)
+}
+
+void integrateVerlet(KernelPath path, ParticleState &state, float dt, glm::vec3 gravity) {
+	DISPATCH(path, verlet, state, dt, gravity)
+}
+
+void rk4Stage(KernelPath path, const ParticleState &state, SoAVec3 &stagePos, SoAVec3 &stageVel, const SoAVec3 &stageForce, SoAVec3 &sumPos, SoAVec3 &sumVel, float weight, float next, glm::vec3 gravity) {
+	DISPATCH(path, rk4StageImpl, state, stagePos, stageVel, stageForce, sumPos, sumVel, weight, next, gravity)
+}
+
+void rk4Finish(KernelPath path, ParticleState &state, const SoAVec3 &sumPos, const SoAVec3 &sumVel, float dt) {
+	DISPATCH(path, rk4FinishImpl, state, sumPos, sumVel, dt)
+}
+
+void collideNodes(KernelPath path, ParticleState &state, int begin, int end, const Collider *colliders, int count, float dt, bool swept) {
+	DISPATCH(path, collideNodesImpl, state, begin, end, colliders, count, dt, swept, nullptr, 1)
+}
+
+void accumulateEnsembleForces(KernelPath path, const SoAVec3 &pos, const SoAVec3 &vel, SoAVec3 &force, const Spring *springs, int count, const float *Ke, const float *Kd, int lanes) {
+	DISPATCH(path, ensembleForces, pos, vel, force, springs, count, Ke, Kd, lanes)
+}
+
+void limitEnsembleStrain(KernelPath path, SoAVec3 &pos, const float *invMass, const Spring *springs, int count, const float *maxScale, int lanes, int iterations, float tolerance) {
+	DISPATCH(path, ensembleStrain, pos, invMass, springs, count, maxScale, lanes, iterations, tolerance)
+}
+
+void collideEnsembleNodes(KernelPath path, ParticleState &state, const Collider *colliders, int count, const float *elasticity, int lanes, float dt, bool swept) {
+	DISPATCH(path, collideNodesImpl, state, 0, state.capacity, colliders, count, dt, swept, elasticity, lanes)
+}
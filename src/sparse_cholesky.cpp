@@ -0,0 +1,100 @@
+#include <cmath>
+
+#include "sparse_cholesky.h"
+
+namespace {
+
+	//Pattern of row k of L: nodes reached walking up the elimination tree from the entries of column k of A.
+	//They are left on stack[top..n), topologically sorted. "mark" must hold values different from k
+	int rowPattern(int k, const std::vector<int> &columnStart, const std::vector<int> &row, const std::vector<int> &parent, std::vector<int> &stack, std::vector<int> &mark) {
+
+		int n = (int)parent.size();
+		int top = n;
+		mark[k] = k;
+		for (int p = columnStart[k]; p < columnStart[k + 1]; p++) {
+			int i = row[p];
+			if (i > k) { continue; }
+			int length = 0;
+			for (; mark[i] != k; i = parent[i]) {
+				stack[length++] = i;
+				mark[i] = k;
+			}
+			while (length > 0) { stack[--top] = stack[--length]; }
+		}
+		return top;
+	}
+}
+
+bool SparseCholesky::factor(int size, const std::vector<int> &columnStart, const std::vector<int> &row, const std::vector<double> &value) {
+
+	n = size;
+
+	//Elimination tree, with path compression through "ancestor"
+	parent.assign(n, -1);
+	std::vector<int> ancestor(n, -1);
+	for (int k = 0; k < n; k++) {
+		for (int p = columnStart[k]; p < columnStart[k + 1]; p++) {
+			for (int i = row[p], next; i != -1 && i < k; i = next) {
+				next = ancestor[i];
+				ancestor[i] = k;
+				if (next == -1) { parent[i] = k; }
+			}
+		}
+	}
+
+	//Column counts of L from the row patterns
+	std::vector<int> stack(n), mark(n, -1), count(n, 1);
+	for (int k = 0; k < n; k++) {
+		for (int top = rowPattern(k, columnStart, row, parent, stack, mark); top < n; top++) { count[stack[top]]++; }
+	}
+	Lp.assign(n + 1, 0);
+	for (int k = 0; k < n; k++) { Lp[k + 1] = Lp[k] + count[k]; }
+	Li.assign(Lp[n], 0);
+	Lx.assign(Lp[n], 0.0);
+
+	//Up-looking numeric factorization: row k of L is a sparse triangular solve with the rows above
+	std::vector<int> next(Lp.begin(), Lp.end() - 1);
+	std::vector<double> x(n, 0.0);
+	mark.assign(n, -1);
+	for (int k = 0; k < n; k++) {
+		int top = rowPattern(k, columnStart, row, parent, stack, mark);
+		x[k] = 0;
+		for (int p = columnStart[k]; p < columnStart[k + 1]; p++) {
+			if (row[p] <= k) { x[row[p]] = value[p]; }
+		}
+
+		double diagonal = x[k];
+		x[k] = 0;
+		for (; top < n; top++) {
+			int i = stack[top];
+			double lki = x[i] / Lx[Lp[i]];
+			x[i] = 0;
+			for (int p = Lp[i] + 1; p < next[i]; p++) { x[Li[p]] -= Lx[p] * lki; }
+			diagonal -= lki * lki;
+			int p = next[i]++;
+			Li[p] = k;
+			Lx[p] = lki;
+		}
+
+		if (diagonal <= 0) { return false; }
+		int p = next[k]++;
+		Li[p] = k;
+		Lx[p] = sqrt(diagonal);
+	}
+	return true;
+}
+
+void SparseCholesky::solve(glm::dvec3 *x) const {
+
+	//L y = b
+	for (int j = 0; j < n; j++) {
+		x[j] /= Lx[Lp[j]];
+		for (int p = Lp[j] + 1; p < Lp[j + 1]; p++) { x[Li[p]] -= Lx[p] * x[j]; }
+	}
+
+	//L' x = y
+	for (int j = n - 1; j >= 0; j--) {
+		for (int p = Lp[j] + 1; p < Lp[j + 1]; p++) { x[j] -= Lx[p] * x[Li[p]]; }
+		x[j] /= Lx[Lp[j]];
+	}
+}
@@ -0,0 +1,75 @@
+#include <cmath>
+#include <cstdint>
+#include <cassert>
+
+#include "springs.h"
+
+void buildSprings(std::vector<Spring> &springs, int rows, int columns, float L) {
+
+	//Every spring is stored once, from the node with the lowest index, so no spring is evaluated twice
+	springs.clear();
+	springs.reserve(6 * rows * columns);
+
+	float diagonalL = sqrtf(L*L + L*L);
+
+	for (int row = 0; row < rows; row++) {
+		for (int col = 0; col < columns; col++) {
+			int i = row * columns + col;
+
+			//Structural
+			if (col + 1 < columns) { springs.push_back({ i, i + 1, L, SpringKind::Structural }); } //Dreta
+			if (row + 1 < rows) { springs.push_back({ i, i + columns, L, SpringKind::Structural }); } //Abaix
+
+			//Shear
+			if (col + 1 < columns && row + 1 < rows) { springs.push_back({ i, i + columns + 1, diagonalL, SpringKind::Shear }); } //Diagonal dreta abaix
+			if (col > 0 && row + 1 < rows) { springs.push_back({ i, i + columns - 1, diagonalL, SpringKind::Shear }); } //Diagonal esquerra abaix
+
+			//Bending
+			if (col + 2 < columns) { springs.push_back({ i, i + 2, L * 2, SpringKind::Bending }); } //Doble dreta
+			if (row + 2 < rows) { springs.push_back({ i, i + 2 * columns, L * 2, SpringKind::Bending }); } //Doble abaix
+		}
+	}
+}
+
+void setRestLengths(std::vector<Spring> &springs, float L) {
+
+	float diagonalL = sqrtf(L*L + L*L);
+	for (Spring &spring : springs) {
+		switch (spring.kind) {
+		case SpringKind::Structural: spring.restLength = L; break;
+		case SpringKind::Shear: spring.restLength = diagonalL; break;
+		case SpringKind::Bending: spring.restLength = L * 2; break;
+		}
+	}
+}
+
+void colorSprings(std::vector<Spring> &springs, int totalVertex, std::vector<int> &colorOffsets) {
+
+	//Greedy coloring: every spring takes the first color not used yet by any of its two nodes
+	const int maxColors = 64;
+	std::vector<uint64_t> usedColors(totalVertex, 0);
+	std::vector<int> springColor(springs.size());
+	int colors = 0;
+
+	for (size_t s = 0; s < springs.size(); s++) {
+		uint64_t used = usedColors[springs[s].i] | usedColors[springs[s].j];
+		int color = 0;
+		while (color < maxColors && (used >> color) & 1) { color++; }
+		assert(color < maxColors);
+
+		springColor[s] = color;
+		usedColors[springs[s].i] |= uint64_t(1) << color;
+		usedColors[springs[s].j] |= uint64_t(1) << color;
+		if (color + 1 > colors) { colors = color + 1; }
+	}
+
+	//Counting sort by color, keeping the build order inside each color so the result is always the same
+	colorOffsets.assign(colors + 1, 0);
+	for (int color : springColor) { colorOffsets[color + 1]++; }
+	for (int c = 0; c < colors; c++) { colorOffsets[c + 1] += colorOffsets[c]; }
+
+	std::vector<int> next(colorOffsets.begin(), colorOffsets.end() - 1);
+	std::vector<Spring> sorted(springs.size());
+	for (size_t s = 0; s < springs.size(); s++) { sorted[next[springColor[s]]++] = springs[s]; }
+	springs.swap(sorted);
+}
@@ -0,0 +1,88 @@
+#include <glm/glm.hpp>
+#include <atomic>
+#include <vector>
+
+#include "strain_limit.h"
+
+namespace {
+	const int strainGrain = 2048; //Springs per parallel task
+
+	//Returns the correction of node i for a spring longer than maxLength, node j gets the opposite one scaled by its weight
+	template <class Real>
+	inline bool springCorrection(const glm::tvec3<Real> &Pi, const glm::tvec3<Real> &Pj, Real wi, Real wj, Real maxLength, glm::tvec3<Real> &correction, Real &distance) {
+
+		glm::tvec3<Real> delta = Pi - Pj;
+		distance = glm::length(delta);
+		if (distance <= maxLength || wi + wj <= 0) { return false; }
+
+		correction = ((maxLength - distance) / ((wi + wj) * distance)) * delta;
+		return true;
+	}
+}
+
+template <class Real>
+int limitStrain(BasicSoAVec3<Real> &positions, const float invMass[], int totalVertex, const std::vector<Spring> &springs, const std::vector<int> &colors,
+	const StrainLimitParams &params, BasicStrainScratch<Real> &scratch, ThreadPool &pool) {
+
+	typedef glm::tvec3<Real> Vec3;
+	std::vector<Vec3> &jacobiDelta = scratch.delta;
+	std::vector<int> &jacobiCount = scratch.count;
+	const Real maxScale = 1 + (Real)params.maxElongation;
+	const Real tolerance = (Real)params.tolerance;
+	const bool jacobi = params.ordering == StrainOrdering::Jacobi;
+
+	int iteration = 0;
+	while (iteration < params.iterations) {
+		iteration++;
+		std::atomic<bool> stretched{ false }; //A spring over the tolerance, any thread can only set it
+		if (jacobi) {
+			jacobiDelta.assign(totalVertex, Vec3(0, 0, 0));
+			jacobiCount.assign(totalVertex, 0);
+		}
+
+		for (size_t color = 0; color + 1 < colors.size(); color++) {
+			pool.parallelFor(colors[color + 1] - colors[color], strainGrain, [&](int begin, int end) {
+				bool over = false;
+				Vec3 correction;
+				Real distance;
+				for (int s = colors[color] + begin; s < colors[color] + end; s++) {
+					const Spring &spring = springs[s];
+					if (spring.kind == SpringKind::Bending) { continue; }
+					Real wi = invMass[spring.i], wj = invMass[spring.j];
+					Real maxLength = spring.restLength * maxScale;
+					if (!springCorrection(positions.get(spring.i), positions.get(spring.j), wi, wj, maxLength, correction, distance)) { continue; }
+					over = over || distance > maxLength + tolerance * spring.restLength;
+
+					if (!jacobi) {
+						//Corrections are applied right away, so the next colors see the updated positions
+						positions.set(spring.i, positions.get(spring.i) + wi * correction);
+						positions.set(spring.j, positions.get(spring.j) - wj * correction);
+					}
+					else {
+						//Corrections are accumulated from the same positions and averaged per node
+						jacobiDelta[spring.i] += wi * correction;
+						jacobiDelta[spring.j] -= wj * correction;
+						jacobiCount[spring.i]++;
+						jacobiCount[spring.j]++;
+					}
+				}
+				if (over) { stretched.store(true, std::memory_order_relaxed); }
+			});
+		}
+
+		if (jacobi) {
+			pool.parallelFor(totalVertex, strainGrain, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					if (jacobiCount[i] > 0) { positions.set(i, positions.get(i) + jacobiDelta[i] / (Real)jacobiCount[i]); }
+				}
+			});
+		}
+		if (!stretched.load()) { break; }
+	}
+	return iteration;
+}
+
+template int limitStrain(SoAVec3 &positions, const float invMass[], int totalVertex, const std::vector<Spring> &springs, const std::vector<int> &colors,
+	const StrainLimitParams &params, StrainScratch &scratch, ThreadPool &pool);
+template int limitStrain(SoAVec3Double &positions, const float invMass[], int totalVertex, const std::vector<Spring> &springs, const std::vector<int> &colors,
+	const StrainLimitParams &params, StrainScratchDouble &scratch, ThreadPool &pool);
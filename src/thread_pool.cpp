@@ -0,0 +1,108 @@
+#include "thread_pool.h"
+#include "profiler.h"
+
+ThreadPool::~ThreadPool() {
+
+	setThreadCount(1);
+}
+
+void ThreadPool::setThreadCount(int threads) {
+
+	if (threads < 1) { threads = 1; }
+	if (threads == threadCount()) { return; }
+
+	//Stop the current workers and start the new ones
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (std::thread &worker : workers) { worker.join(); }
+	workers.clear();
+
+	quit = false;
+	for (int i = 1; i < threads; i++) { workers.emplace_back(&ThreadPool::workerLoop, this); }
+}
+
+void ThreadPool::runChunks(const std::function<void(int, int)> &task, int count, int grain, const char *name) {
+
+#ifdef CLOTH_PROFILING
+	TRACE_SCOPE(name ? name : "Pool job"); //The share of the job of every thread
+#else
+	(void)name;
+#endif
+	int chunks = (count + grain - 1) / grain;
+	for (int chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+		int begin = chunk * grain;
+		task(begin, begin + grain < count ? begin + grain : count);
+
+		if (--pendingChunks == 0) {
+			std::lock_guard<std::mutex> lock(mutex);
+			done.notify_all();
+		}
+	}
+}
+
+void ThreadPool::workerLoop() {
+
+	TRACE_THREAD_NAME("Pool worker");
+	unsigned seenGeneration = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		seenGeneration = generation;
+	}
+
+	for (;;) {
+		const std::function<void(int, int)> *task;
+		int count, grain;
+		const char *name;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || generation != seenGeneration; });
+			if (quit) { return; }
+			seenGeneration = generation;
+			if (job == nullptr) { continue; } //Woke up after the job was finished
+			task = job;
+			count = jobCount;
+			grain = jobGrain;
+			name = jobName;
+			activeWorkers++;
+		}
+
+		runChunks(*task, count, grain, name);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			activeWorkers--;
+		}
+		done.notify_all();
+	}
+}
+
+void ThreadPool::parallelFor(int count, int grain, const std::function<void(int begin, int end)> &task) {
+
+	if (count <= 0) { return; }
+	if (grain < 1) { grain = 1; }
+	if (workers.empty() || count <= grain) { task(0, count); return; }
+
+	{
+		//A worker still leaving the previous job could otherwise take chunks of this one
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&] { return activeWorkers == 0; });
+		job = &task;
+		jobCount = count;
+		jobGrain = grain;
+		jobName = TRACE_CURRENT_SCOPE();
+		nextChunk = 0;
+		pendingChunks = (count + grain - 1) / grain;
+		generation++;
+	}
+	wake.notify_all();
+
+	runChunks(task, count, grain, jobName);
+
+	TRACE_SCOPE("Wait for workers");
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return pendingChunks == 0 && activeWorkers == 0; });
+	job = nullptr;
+}
@@ -0,0 +1,123 @@
+#include "work_stealing_pool.h"
+#include "profiler.h"
+
+WorkStealingPool::~WorkStealingPool() {
+
+	setThreadCount(1);
+}
+
+void WorkStealingPool::setThreadCount(int threads) {
+
+	if (threads < 1) { threads = 1; }
+	if (threads == threadCount() && !queues.empty()) { return; }
+
+	//Stop the current workers and start the new ones
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (std::thread &worker : workers) { worker.join(); }
+	workers.clear();
+
+	quit = false;
+	queues.clear();
+	for (int i = 0; i < threads; i++) { queues.emplace_back(new Queue()); }
+	for (int i = 1; i < threads; i++) { workers.emplace_back(&WorkStealingPool::workerLoop, this, i); }
+}
+
+bool WorkStealingPool::takeTask(int thread, int &task) {
+
+	//Own tasks from the front, the cheapest ones of the others from their back
+	int threads = (int)queues.size();
+	for (int k = 0; k < threads; k++) {
+		Queue &queue = *queues[(thread + k) % threads];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) { continue; }
+		if (k == 0) {
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+		}
+		else {
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			stolen++;
+		}
+		return true;
+	}
+	return false;
+}
+
+void WorkStealingPool::runTasks(int thread, const std::function<void(int)> &task) {
+
+	//Tasks are only added before the run starts, so empty queues mean this thread is done
+	int next;
+	while (takeTask(thread, next)) {
+		task(next);
+
+		if (--pendingTasks == 0) {
+			std::lock_guard<std::mutex> lock(mutex);
+			done.notify_all();
+		}
+	}
+}
+
+void WorkStealingPool::workerLoop(int thread) {
+
+	TRACE_THREAD_NAME("World worker");
+	unsigned seenGeneration = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		seenGeneration = generation;
+	}
+
+	for (;;) {
+		const std::function<void(int)> *task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || generation != seenGeneration; });
+			if (quit) { return; }
+			seenGeneration = generation;
+			if (job == nullptr) { continue; } //Woke up after the run was finished
+			task = job;
+			activeWorkers++;
+		}
+
+		runTasks(thread, *task);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			activeWorkers--;
+		}
+		done.notify_all();
+	}
+}
+
+void WorkStealingPool::run(const std::vector<int> &order, const std::function<void(int task)> &task) {
+
+	if (order.empty()) { return; }
+	if (queues.empty()) { setThreadCount(1); }
+	stolen = 0;
+	if (workers.empty() || order.size() == 1) {
+		for (int i : order) { task(i); }
+		return;
+	}
+
+	{
+		//A worker still leaving the previous run could otherwise take tasks of this one
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&] { return activeWorkers == 0; });
+		int threads = (int)queues.size();
+		for (size_t i = 0; i < order.size(); i++) { queues[i % threads]->tasks.push_back(order[i]); }
+		pendingTasks = (int)order.size();
+		job = &task;
+		generation++;
+	}
+	wake.notify_all();
+
+	runTasks(0, task);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return pendingTasks == 0 && activeWorkers == 0; });
+	job = nullptr;
+}
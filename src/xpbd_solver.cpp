@@ -0,0 +1,101 @@
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "integrators.h"
+
+namespace {
+
+	//Extended Position Based Dynamics: every spring is a compliant distance constraint with compliance 1 / Ke.
+	//Kd is used as the constraint damping. Constraints of a spring color are solved in parallel (Gauss-Seidel between colors)
+	class XPBDSolver : public Integrator {
+	public:
+		IntegratorType type() const override { return IntegratorType::XPBD; }
+		bool usesForces() const override { return false; }
+
+		void step(KernelPath, ParticleState &state, const IntegrationContext &context, float dt, glm::vec3 gravity) override {
+
+			const std::vector<Spring> &springs = *context.springs;
+			const std::vector<int> &colors = *context.springColors;
+			ThreadPool &pool = *context.pool;
+			const int n = state.count;
+			const int substeps = context.substeps > 0 ? context.substeps : 1;
+			const float h = dt / substeps;
+
+			if ((int)predicted.size() != n) {
+				predicted.assign(n, glm::vec3(0, 0, 0));
+				start.assign(n, glm::vec3(0, 0, 0));
+			}
+			lambda.resize(springs.size());
+
+			//Collisions test the whole step, so "last" is the position before the first substep
+			copySoA(state.last, state.pos, state.capacity);
+
+			const float compliance = 1.f / (context.Ke * h * h); //alpha / h^2
+			const float damping = compliance * context.Kd * h; //gamma = alpha / h^2 * beta * h = Kd / (Ke h), beta = Kd as in the spring forces
+
+			for (int substep = 0; substep < substeps; substep++) {
+
+				//Predict with the external forces
+				pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+					for (int i = begin; i < end; i++) {
+						glm::vec3 velocity = state.vel.get(i) + h * state.invMass[i] * gravity;
+						start[i] = state.pos.get(i);
+						predicted[i] = start[i] + h * velocity;
+					}
+				});
+				std::fill(lambda.begin(), lambda.end(), 0.f);
+
+				for (int iteration = 0; iteration < context.iterations; iteration++) {
+					for (size_t color = 0; color + 1 < colors.size(); color++) {
+						pool.parallelFor(colors[color + 1] - colors[color], springGrain, [&](int begin, int end) {
+							for (int s = colors[color] + begin; s < colors[color] + end; s++) {
+								solveConstraint(springs[s], lambda[s], state.invMass, compliance, damping);
+							}
+						});
+					}
+				}
+
+				//New velocities from the positions
+				pool.parallelFor(n, nodeGrain, [&](int begin, int end) {
+					for (int i = begin; i < end; i++) {
+						state.vel.set(i, (predicted[i] - start[i]) / h);
+						state.pos.set(i, predicted[i]);
+					}
+				});
+			}
+		}
+
+	private:
+		static const int nodeGrain = 4096;
+		static const int springGrain = 2048;
+
+		inline void solveConstraint(const Spring &spring, float &springLambda, const float *invMass, float compliance, float damping) {
+
+			float wi = invMass[spring.i], wj = invMass[spring.j];
+			if (wi + wj <= 0) { return; }
+
+			glm::vec3 delta = predicted[spring.i] - predicted[spring.j];
+			float length = glm::length(delta);
+			if (length <= 0) { return; }
+			glm::vec3 normal = delta / length;
+
+			//Relative displacement along the constraint on this substep, for the damping
+			float relative = glm::dot(normal, (predicted[spring.i] - start[spring.i]) - (predicted[spring.j] - start[spring.j]));
+
+			float C = length - spring.restLength;
+			float deltaLambda = (-C - compliance * springLambda - damping * relative) / ((1 + damping) * (wi + wj) + compliance);
+			springLambda += deltaLambda;
+			predicted[spring.i] += wi * deltaLambda * normal;
+			predicted[spring.j] -= wj * deltaLambda * normal;
+		}
+
+		std::vector<glm::vec3> predicted;
+		std::vector<glm::vec3> start; //Positions at the beginning of the substep
+		std::vector<float> lambda;
+	};
+}
+
+std::unique_ptr<Integrator> createXPBDSolver() {
+
+	return std::unique_ptr<Integrator>(new XPBDSolver());
+}